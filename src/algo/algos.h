@@ -1,4 +1,5 @@
 #include "delta_stepping_parallel.h"
+#include "delta_stepping_spmd.h"
 #include "completely_balanced_delta_stepping.h"
 #include "completely_balanced_delta_stepping_2.h"
 #include "delta_stepping_sequential.h"
@@ -0,0 +1,113 @@
+#ifndef BUCKET_POLICY_H
+#define BUCKET_POLICY_H
+
+#include <cmath>
+#include <cstdint>
+
+// How the parallel delta-stepping workspace maps tentative distances to its count() buckets,
+// chosen by the BucketPolicy parameter of DeltaSteppingWorkspace. Distances are counted in units of delta.
+//  RingBuckets      ceil(max_weight / delta) + 5 buckets used as a ring, unit k goes to bucket
+//                   k mod count(). Buckets are never split, but their number grows with the weight range.
+//  TwoLevelBuckets  FINE buckets of one unit for the current window (an aligned block of FINE units),
+//                   COARSE buckets of one block each for the blocks after it, and an overflow bucket
+//                   for everything beyond. A constant number of buckets whatever the weights; when the
+//                   window runs empty the workspace splits the next occupied coarse bucket into the fine
+//                   ones, or the overflow bucket once nothing else is left (see next_bucket()).
+
+struct RingBuckets {
+    static constexpr bool TWO_LEVEL = false;
+
+    RingBuckets(double delta, double max_weight): delta(delta), buckets((int)std::ceil(max_weight / delta) + 5) {}
+
+    int count() const {
+        return buckets;
+    }
+
+    int bucket_of(double distance) const {
+        return int(distance / delta) % buckets;
+    }
+
+    // the bucket processed after bucket
+    int successor(int bucket) const {
+        return (bucket + 1) % buckets;
+    }
+
+    void reset() {}
+
+    static const char *name() {
+        return "ring";
+    }
+
+private:
+    double delta;
+    int buckets;
+};
+
+template<int FINE_BUCKETS = 256, int COARSE_BUCKETS = 64>
+struct TwoLevelBuckets {
+    static constexpr bool TWO_LEVEL = true;
+    static constexpr int FINE = FINE_BUCKETS, COARSE = COARSE_BUCKETS, OVERFLOW = FINE + COARSE;
+
+    TwoLevelBuckets(double delta, double): delta(delta) {}
+
+    int count() const {
+        return FINE + COARSE + 1;
+    }
+
+    // units below the window (rounding) keep to the fine ring, the workspace finds them on its next lap
+    int bucket_of(double distance) const {
+        uint64_t unit = uint64_t(distance / delta);
+        uint64_t block = unit / FINE;
+        if (block >= overflow_block) {
+            return OVERFLOW;
+        }
+        if (block <= window_block) {
+            return int(unit % FINE);
+        }
+        return coarse_bucket(block);
+    }
+
+    uint64_t block_of(double distance) const {
+        return uint64_t(distance / delta) / FINE;
+    }
+
+    // the fine bucket processed after the fine bucket bucket, a lap later at the end of the window
+    int successor(int bucket) const {
+        return (bucket + 1) % FINE;
+    }
+
+    void reset() {
+        window_block = 0;
+        overflow_block = COARSE + 1;
+    }
+
+    static const char *name() {
+        return "two-level";
+    }
+
+    // blocks of the window and of the first overflow block; the coarse buckets hold the blocks in between
+    uint64_t window_block = 0, overflow_block = COARSE + 1;
+
+    // The bucket holding block: a coarse one, or the overflow bucket past the coarse range
+    int bucket_of_block(uint64_t block) const {
+        return block < overflow_block ? coarse_bucket(block) : OVERFLOW;
+    }
+
+    // Make block, a block after the window, the new window. Past the coarse range the range restarts
+    // behind the new window, so blocks leave the overflow bucket only when it is split.
+    void set_window(uint64_t block) {
+        window_block = block;
+        if (block >= overflow_block) {
+            overflow_block = block + COARSE + 1;
+        }
+    }
+
+    static int coarse_bucket(uint64_t block) {
+        return FINE + int(block % COARSE);
+    }
+
+private:
+    double delta;
+};
+
+#endif
@@ -11,10 +11,10 @@
 #include <type_traits>
 #include "pools/fixed_task_pool.h"
 #include "lists/thread_safe_vector.h"
-#include "lists/circular_vector.h"
+#include "lists/segmented_vector.h"
+#include "delta_stepping_workspace.h"
 #include <cmath>
 #include <atomic>
-#include <barrier>
 #include <algorithm>
 
 class CompletelyBalancedDeltaStepping : public ShortestPathSolverBase {
@@ -23,114 +23,58 @@ public:
         return "Parallel delta stepping with optimized load balancing";
     }
 
-    using Request = Edge;
+    CompletelyBalancedDeltaStepping(double delta, int num_threads, InlinePolicy inline_policy = InlinePolicy()):
+        delta(delta), num_threads(num_threads), inline_policy(inline_policy) {}
 
-    CompletelyBalancedDeltaStepping(double delta, int num_threads): delta(delta), num_threads(num_threads) {}
+    using Workspace = DeltaSteppingWorkspace<SegmentedVector<int>, FixedTaskPool>;
 
     std::vector<double> compute(const Graph &graph, int source) const override {
-        const double INF_MAX = std::numeric_limits<double>::infinity();
-        int n = graph.size();
-        std::vector<double> dist(n, INF_MAX);
-
-        std::vector<size_t> adj_sizes(n);
-        for (int u = 0; u < n; ++u) {
-            adj_sizes[u] = graph[u].size();
-        }
-
-        const int MAX_BUCKET_COUNT = (int)std::ceil(graph.get_max_edge_weight() / delta) + 5;
-
-        std::vector<int> position_in_bucket(n, -1);
-        std::vector<CircularVector<int>> buckets;
-        buckets.reserve(MAX_BUCKET_COUNT);
-
-        for (int i = 0; i < MAX_BUCKET_COUNT; ++i) {
-            buckets.emplace_back(n);
-        }
-        
-        buckets[0].push(source);
-        position_in_bucket[source] = 0;
-        dist[source] = 0;
-
-        std::vector<int> light_nodes_requested(n), heavy_nodes_requested(n);
-        std::atomic<size_t> light_nodes_counter{0}, heavy_nodes_counter{0};
-
-        std::vector<std::atomic<double>> light_request_map(n), heavy_request_map(n);
-
-        std::vector<int> updated_nodes(n);
-        std::atomic<size_t> updated_counter{0};
-
-        int current_generation = 0;
-        
-        for (int i = 0; i < n; ++i) {
-            light_request_map[i].store(std::numeric_limits<double>::infinity());
-            heavy_request_map[i].store(std::numeric_limits<double>::infinity());
-        }
-
-        auto get_bucket = [&] (int v) {
-            if (dist[v] == INF_MAX) {
-                return -1;
-            }
-            return int(dist[v] / delta) % MAX_BUCKET_COUNT;
-        };
+        return solve(workspace_cache.get(graph, delta, num_threads, false), source);
+    }
 
-        auto relax = [&] (int v, std::vector<std::atomic<double>> &requests) {
-            double new_distance = requests[v].exchange(std::numeric_limits<double>::infinity());
-            // note: during light edge relaxation, multiple readers - one writer can happen
-            // but that is fine, because the next epoch will take care of this concurrency issue
-            if (new_distance < dist[v]) {
-                int old_bucket = get_bucket(v);
-                dist[v] = new_distance;
-                int new_bucket = get_bucket(v);
-                if (old_bucket != -1 && old_bucket != current_generation && old_bucket != new_bucket) { // since current generation bucket is always cleared
-                    buckets[old_bucket][position_in_bucket[v]] = -1;
-                }
-                if (old_bucket == current_generation || old_bucket != new_bucket) {
-                    position_in_bucket[v] = buckets[new_bucket].push(v);
-                }
-            }
-        };
+    void release_workspace() const override {
+        workspace_cache.release();
+    }
 
-        // Strictest request optimization -- No mutexes
-        auto add_request = [&] (std::vector<int> &requested_nodes, std::atomic<size_t> &idx_counter, std::vector<std::atomic<double>> &requests, const Request &request) {
-            std::atomic<double> &state = requests[request.v];
-            double new_distance = dist[request.u] + request.w;
-          
-            if (std::isinf(state.load())) {
-                double curr_state = state.load();
-                while (std::isinf(curr_state) && !state.compare_exchange_weak(curr_state, new_distance));
-                if (std::isinf(curr_state)) {
-                    size_t curr_idx = idx_counter.fetch_add(1);
-                    requested_nodes[curr_idx] = request.v;
-                }
-            }
+    std::vector<std::pair<std::string, uint64_t>> last_query_counters() const override {
+        return workspace_cache.counters();
+    }
 
-            double current_distance = state.load();
-            while (new_distance < current_distance && !state.compare_exchange_weak(current_distance, new_distance));
+    // Run one query on a workspace bound to the graph; the result stays valid until the next query on it
+    std::vector<double> solve(Workspace &ws, int source) const {
+        ws.reset(source);
+
+        const Graph &graph = ws.graph;
+        const double delta = ws.delta;
+        const int workers = ws.num_threads;
+        std::vector<SegmentedVector<int>> &buckets = ws.buckets;
+        ThreadLocalLists<int> &light_requests = ws.light_requests, &heavy_requests = ws.heavy_requests;
+        int &current_generation = ws.current_generation;
+        FixedTaskPool &pool = ws.pool;
+        // relaxing a request scans no edges, only the request count matters
+        auto no_edges = [] {
+            return size_t(0);
         };
 
-        // bucket type is either linked list or vector
-        std::barrier<> barrier(num_threads + 1);
-        FixedTaskPool pool(num_threads, barrier);
         // Parallel prefix-sum over nodes to build global edge prefix
-        std::vector<size_t> prefix(n, 0);   // prefix[0] = 0 by default
-        std::vector<size_t> thread_totals(num_threads, 0);
-        std::vector<size_t> thread_offsets(num_threads + 1, 0);
-
-        int generations_without_bucket = 0;
-        for (current_generation = 0; ; ++current_generation, ++generations_without_bucket) {
-            if (generations_without_bucket >= MAX_BUCKET_COUNT) {
-                break;
-            }
-            if (current_generation >= MAX_BUCKET_COUNT) {
-                current_generation = 0;
-            }
+        std::vector<size_t> &prefix = ws.prefix;
+        if (prefix.size() != (size_t)graph.size()) {
+            prefix.assign(graph.size(), 0);
+        }
+        std::vector<size_t> thread_totals(workers, 0);
+        std::vector<size_t> thread_offsets(workers + 1, 0);
+
+        for (current_generation = 0; current_generation >= 0; current_generation = ws.next_bucket(current_generation)) {
             while (!buckets[current_generation].empty()) {
-                generations_without_bucket = 0;
 
                 {
                     // Loop 1: request generation
-                    CircularVector<int> &curr_bucket = buckets[current_generation];
+                    SegmentedVector<int> &curr_bucket = buckets[current_generation];
                     size_t curr_bucket_size = curr_bucket.size();
+                    // padded bucket blocks can make a bucket longer than the vertex count
+                    if (prefix.size() < curr_bucket_size) {
+                        prefix.resize(curr_bucket_size);
+                    }
 
                     prefix[0] = 0;
                     for (size_t i = 0; i < curr_bucket_size; ++i) {
@@ -139,20 +83,25 @@ public:
                             prefix[i] = prefix[i - 1];
                         }
                         if (u >= 0) {
-                            prefix[i] += adj_sizes[u];
+                            prefix[i] += graph.degree(u);
                         }
                     }
                     size_t total_edges = prefix[curr_bucket_size - 1];
+                    // a small bucket is scanned by the calling thread as a single part
+                    bool inline_phase = ws.run_inline(inline_policy, curr_bucket_size, [&] {
+                        return total_edges;
+                    });
+                    const int parts = inline_phase ? 1 : workers;
                     
                     // prefix ready – no need for extra barrier here
                     // (D) Even split of edges across threads using the global prefix
-                    const size_t edge_chunk = (total_edges + num_threads - 1) / num_threads;
+                    const size_t edge_chunk = (total_edges + parts - 1) / parts;
 
-                    for (int tid = 0; tid < num_threads; ++tid) {
+                    for (int tid = 0; tid < parts; ++tid) {
                         size_t start_e = static_cast<size_t>(tid) * edge_chunk;
                         size_t end_e   = std::min(total_edges, start_e + edge_chunk);
 
-                        pool.push(tid, [&, start_e, end_e] {
+                        auto generate = [&, tid, start_e, end_e] {
                             if (start_e >= end_e) {
                                 return;
                             }
@@ -165,15 +114,17 @@ public:
                             while (curr_edge < end_e && node_idx < curr_bucket_size) {
                                 int u = curr_bucket[node_idx];
                                 if (u >= 0) {
-                                    size_t deg = adj_sizes[u];
+                                    AdjacencyRange adj = graph[u];
+                                    size_t deg = adj.size();
                                     for (size_t k = edge_off; k < deg && curr_edge < end_e; ++k, ++curr_edge) {
-                                        const auto &[v, w] = graph[u][k];
-                                        if (dist[u] + w < dist[v]) {
+                                        int v = adj.targets()[k];
+                                        double w = adj.weights()[k];
+                                        if (ws.vertices.dist(u) + w < ws.vertices.dist(v)) {
                                             if (w < delta) {
-                                                add_request(light_nodes_requested, light_nodes_counter, light_request_map, Request{u, v, w});
+                                                ws.add_light_request(u, v, w, tid);
                                             }
                                             else {
-                                                add_request(heavy_nodes_requested, heavy_nodes_counter, heavy_request_map, Request({u, v, w}));
+                                                ws.add_heavy_request(u, v, w, tid);
                                             }
                                         }
                                     }
@@ -181,69 +132,62 @@ public:
                                 ++node_idx;
                                 edge_off = 0;
                             }
-                        });
+                        };
+                        if (inline_phase) {
+                            generate();
+                        }
+                        else {
+                            pool.push(tid, generate);
+                        }
                     }
 
-                    barrier.arrive_and_wait(); // ensure all edge processing done
+                    if (!inline_phase) {
+                        pool.arrive_and_wait(); // ensure all edge processing done
+                    }
 
-                    curr_bucket.clear();
+                    ws.clear_bucket(current_generation);
                 }
 
 
                 // Loop 2: relax light edges
                 {
                     // std::cerr << "loop2\n";
-                    int requests_size = light_nodes_counter;
-                    int chunk_size = (requests_size + num_threads - 1) / num_threads;
-                    for (int idx = 0; idx < num_threads; ++idx) {
-                        int start = idx * chunk_size;
-                        int end = start + chunk_size;
-                        if (end > requests_size) {
-                            end = requests_size;
-                        }
-                        pool.push(idx, [&, start, end] {
-                            for (int idx_r = start; idx_r < end; ++idx_r) {
-                                int request_node = light_nodes_requested[idx_r];
-                                relax(request_node, light_request_map);
-                            }
+                    ws.run_phase(inline_policy, light_requests.scan(), RELAX_GRAIN, no_edges, [&] (size_t tid, size_t first, size_t last) {
+                        light_requests.for_each(first, last, [&] (int request_node) {
+                            ws.relax(request_node, ws.light_requested, tid);
                         });
-                    }
-                    barrier.arrive_and_wait();
+                    }, [&] (size_t tid) {
+                        ws.flush_bucket_blocks(tid);
+                    });
 
-                    light_nodes_counter = 0;
+                    light_requests.clear();
                 }
             }
             
             // Loop 3: relax heavy edges
             {
-                int requests_size = heavy_nodes_counter;
-                int chunk_size = (requests_size + num_threads - 1) / num_threads;
-                for (int idx = 0; idx < num_threads; ++idx) {
-                    int start = idx * chunk_size;
-                    int end = start + chunk_size;
-                    if (end > requests_size) {
-                        end = requests_size;
-                    }
-                    pool.push(idx, [&, start, end] {
-                        for (int idx_r = start; idx_r < end; ++idx_r) {
-                            int request_node = heavy_nodes_requested[idx_r];
-                            relax(request_node, heavy_request_map);
-                        }
+                ws.run_phase(inline_policy, heavy_requests.scan(), RELAX_GRAIN, no_edges, [&] (size_t tid, size_t first, size_t last) {
+                    heavy_requests.for_each(first, last, [&] (int request_node) {
+                        ws.relax(request_node, ws.heavy_requested, tid);
                     });
-                }
-                barrier.arrive_and_wait();
+                }, [&] (size_t tid) {
+                    ws.flush_bucket_blocks(tid);
+                });
 
-                heavy_nodes_counter = 0;
+                heavy_requests.clear();
             }
         }
 
-        pool.stop();
-
-        return dist;
+        return ws.distances();
     }
 private:
+    // requests per parallel_for chunk in the relax loops
+    static constexpr size_t RELAX_GRAIN = 256;
+
     double delta;
     int num_threads;
+    InlinePolicy inline_policy;
+    mutable WorkspaceCache<Workspace> workspace_cache;
 };
 
 #endif
\ No newline at end of file
@@ -11,219 +11,236 @@
 #include <type_traits>
 #include "pools/fixed_task_pool.h"
 #include "lists/thread_safe_vector.h"
-#include "lists/circular_vector.h"
+#include "lists/segmented_vector.h"
+#include "delta_stepping_workspace.h"
 #include <cmath>
 #include <atomic>
 
-class DeltaSteppingParallel : public ShortestPathSolverBase {
+// Optional execution modes of DeltaSteppingParallelT
+struct DeltaSteppingOptions {
+    // Bucket fusion: a task relaxing light requests reprocesses the vertices it keeps in the current bucket
+    // itself, up to fusion_limit of them per phase, before the phase's barrier. On graphs where a bucket
+    // takes many light rounds (roads, grids) this replaces most of those rounds. 0 turns it off.
+    size_t fusion_limit = 0;
+    // phases below these thresholds run on the calling thread without waking the pool
+    InlinePolicy inline_policy;
+    // Deferred heavy relaxation: heavy requests are parked by the bucket they target and applied only when
+    // that bucket comes up, so requests beaten by a later, shorter path are never relaxed.
+    bool defer_heavy = false;
+    // Dynamic light/heavy split: a light edge is relaxed in the light rounds of a bucket only if its target
+    // distance stays in that bucket, every other edge waits for the heavy relaxation. Fewer requests per
+    // light round, and no round spent moving vertices to later buckets.
+    bool dynamic_split = false;
+    // Pipelined heavy relaxation: the heavy requests of a bucket are relaxed in the request generation phase
+    // of the next one instead of a phase of their own, saving a barrier per bucket. Those falling into that
+    // next bucket become its light requests. Has no effect together with defer_heavy.
+    bool pipelined_heavy = false;
+};
+
+// VertexState selects the layout of the per-vertex state (see vertex_state.h),
+// BucketPolicy the mapping of distances to buckets (see bucket_policy.h)
+template<class VertexState, class BucketPolicy = RingBuckets>
+class DeltaSteppingParallelT : public ShortestPathSolverBase {
 public:
     const std::string name() const override {
-        return "Optimized parallel delta stepping";
+        std::string modes;
+        if constexpr (!std::is_same_v<VertexState, SplitVertexState>) {
+            modes = std::string(VertexState::name()) + " vertex state";
+        }
+        if constexpr (!std::is_same_v<BucketPolicy, RingBuckets>) {
+            modes += (modes.empty() ? "" : ", ") + std::string(BucketPolicy::name()) + " buckets";
+        }
+        if (options.fusion_limit > 0) {
+            modes += modes.empty() ? "bucket fusion" : ", bucket fusion";
+        }
+        if (options.defer_heavy) {
+            modes += modes.empty() ? "deferred heavy edges" : ", deferred heavy edges";
+        }
+        if (options.dynamic_split) {
+            modes += modes.empty() ? "dynamic light edges" : ", dynamic light edges";
+        }
+        if (options.pipelined_heavy && !options.defer_heavy) {
+            modes += modes.empty() ? "pipelined heavy edges" : ", pipelined heavy edges";
+        }
+        return "Optimized parallel delta stepping" + (modes.empty() ? "" : " (" + modes + ")");
     }
 
-    using Request = Edge;
+    DeltaSteppingParallelT(double delta, int num_threads, DeltaSteppingOptions options = DeltaSteppingOptions()):
+        delta(delta), num_threads(num_threads), options(options) {}
 
-    DeltaSteppingParallel(double delta, int num_threads): delta(delta), num_threads(num_threads) {}
+    using Workspace = DeltaSteppingWorkspace<SegmentedVector<int>, FixedTaskPool, VertexState, BucketPolicy>;
 
     std::vector<double> compute(const Graph &graph, int source) const override {
-        const double INF_MAX = std::numeric_limits<double>::infinity();
-        int n = graph.size();
-        std::vector<double> dist(n, INF_MAX);
-
-        std::vector<std::vector<AdjEdge>> heavy(n), light(n);
-        for (int u = 0; u < n; ++u) {
-            for (const auto &[v, w] : graph[u]) {
-                if (w < delta) {
-                    light[u].push_back({v, w});
-                }
-                else {
-                    heavy[u].push_back({v, w});
-                }
-            }
-        }
-
-        const int MAX_BUCKET_COUNT = (int)std::ceil(graph.get_max_edge_weight() / delta) + 5;
-
-        std::vector<int> position_in_bucket(n, -1);
-        std::vector<CircularVector<int>> buckets;
-        buckets.reserve(MAX_BUCKET_COUNT);
-        for (int i = 0; i < MAX_BUCKET_COUNT; ++i) {
-            buckets.emplace_back(n);
-        }
-        
-        buckets[0].push(source);
-        position_in_bucket[source] = 0;
-        dist[source] = 0;
-
-        std::vector<int> light_nodes_requested(n), heavy_nodes_requested(n);
-        std::atomic<size_t> light_nodes_counter{0}, heavy_nodes_counter{0};
+        return solve(workspace_cache.get(graph, delta, num_threads), source);
+    }
 
-        std::vector<std::atomic<double>> light_request_map(n), heavy_request_map(n);
+    void release_workspace() const override {
+        workspace_cache.release();
+    }
 
-        std::vector<int> updated_nodes(n);
-        std::atomic<size_t> updated_counter{0};
+    std::vector<std::pair<std::string, uint64_t>> last_query_counters() const override {
+        return workspace_cache.counters();
+    }
 
-        int current_generation = 0;
-        
-        for (int i = 0; i < n; ++i) {
-            light_request_map[i].store(std::numeric_limits<double>::infinity());
-            heavy_request_map[i].store(std::numeric_limits<double>::infinity());
+    // Run one query on a workspace bound to the graph; the result stays valid until the next query on it
+    std::vector<double> solve(Workspace &ws, int source) const {
+        ws.reset(source);
+        if (options.defer_heavy) {
+            ws.enable_parking();
         }
 
-        auto get_bucket = [&] (int v) {
-            if (dist[v] == INF_MAX) {
-                return -1;
-            }
-            return int(dist[v] / delta) % MAX_BUCKET_COUNT;
-        };
+        std::vector<SegmentedVector<int>> &buckets = ws.buckets;
+        ThreadLocalLists<int> &light_requests = ws.light_requests, &heavy_requests = ws.heavy_requests;
+        int &current_generation = ws.current_generation;
 
-        auto relax = [&] (int v, std::vector<std::atomic<double>> &requests) {
-            double new_distance = requests[v].exchange(std::numeric_limits<double>::infinity());
-            // note: during light edge relaxation, multiple readers - one writer can happen
-            // but that is fine, because the next epoch will take care of this concurrency issue
-            if (new_distance < dist[v]) {
-                int old_bucket = get_bucket(v);
-                dist[v] = new_distance;
-                int new_bucket = get_bucket(v);
-                if (old_bucket != -1 && old_bucket != current_generation && old_bucket != new_bucket) { // since current generation bucket is always cleared
-                    buckets[old_bucket][position_in_bucket[v]] = -1;                    
-                }
-                if (old_bucket == current_generation || old_bucket != new_bucket) {
-                    position_in_bucket[v] = buckets[new_bucket].push(v);
-                }
-            }
-        };
+        const size_t fusion_limit = options.fusion_limit;
+        const InlinePolicy &inline_policy = options.inline_policy;
+        const bool pipelined = options.pipelined_heavy && !options.defer_heavy;
+        // heavy requests of the previous bucket still to relax, pipelined mode only
+        size_t carried = 0;
 
-        // Strictest request optimization -- No mutexes
-        auto add_request = [&] (std::vector<int> &requested_nodes, std::atomic<size_t> &idx_counter, std::vector<std::atomic<double>> &requests, const Request &request) {
-            std::atomic<double> &state = requests[request.v];
-            double new_distance = dist[request.u] + request.w;
-          
-            if (std::isinf(state.load())) {
-                double curr_state = state.load();
-                while (std::isinf(curr_state) && !state.compare_exchange_weak(curr_state, new_distance));
-                if (std::isinf(curr_state)) {
-                    size_t curr_idx = idx_counter.fetch_add(1);
-                    requested_nodes[curr_idx] = request.v;
-                }
+        auto flush = [&] (size_t tid) {
+            if (fusion_limit > 0) {
+                ws.fuse(tid, fusion_limit);
             }
-
-            double current_distance = state.load();
-            while (new_distance < current_distance && !state.compare_exchange_weak(current_distance, new_distance));
+            ws.flush_bucket_blocks(tid);
         };
-
-        auto gen_light_request = [&] (int u) {
-            for (const auto &[v, w] : light[u]) {
-                if (dist[u] + w < dist[v]) {
-                    add_request(light_nodes_requested, light_nodes_counter, light_request_map, Request{u, v, w});
-                }
+        auto relax = [&] (int v, ConcurrentBitmap &requested, size_t tid) {
+            if (fusion_limit > 0) {
+                return ws.relax_fused(v, requested, tid, fusion_limit);
             }
+            return ws.relax(v, requested, tid);
         };
-
-        auto gen_heavy_request = [&] (int u) {
-            for (const auto &[v, w] : heavy[u]) {
-                if (dist[u] + w < dist[v]) {
-                    add_request(heavy_nodes_requested, heavy_nodes_counter, heavy_request_map, Request{u, v, w});
-                }
-            }
+        auto relax_heavy = [&] (int v, size_t tid) {
+            ws.count_heavy_relaxation(tid, relax(v, ws.heavy_requested, tid));
+        };
+        // relaxing a request scans no edges (outside bucket fusion), only the request count matters
+        auto no_edges = [] {
+            return size_t(0);
         };
 
         // bucket type is either linked list or vector
-        std::barrier<> barrier(num_threads + 1);
-        FixedTaskPool pool(num_threads, barrier);
+        for (current_generation = 0; current_generation >= 0; ) {
+            // Loop 0: apply the heavy requests parked for this bucket, moving their targets into it
+            ThreadLocalLists<int> *parked = ws.parked_for(current_generation);
+            size_t parked_count = parked != nullptr ? parked->scan() : 0;
+            if (parked_count > 0) {
+                ws.run_phase(inline_policy, parked_count, RELAX_GRAIN, no_edges, [&] (size_t tid, size_t first, size_t last) {
+                    parked->for_each(first, last, [&] (int request_node) {
+                        relax_heavy(request_node, tid);
+                    });
+                }, flush);
 
-        int generations_without_bucket = 0;
-        for (current_generation = 0; ; ++current_generation, ++generations_without_bucket) {
-            if (generations_without_bucket >= MAX_BUCKET_COUNT) {
-                break;
-            }
-            if (current_generation >= MAX_BUCKET_COUNT) {
-                current_generation = 0;
+                parked->clear();
+                // in bucket fusion mode the targets may be processed right here, leaving the bucket empty
+                if (buckets[current_generation].empty()) {
+                    ws.clear_bucket(current_generation);
+                }
             }
-            while (!buckets[current_generation].empty()) {
-                generations_without_bucket = 0;
+            while (carried > 0 || !buckets[current_generation].empty()) {
 
                 {
-                    // Loop 1: request generation
-                    CircularVector<int> &curr_bucket = buckets[current_generation];
-                    int curr_bucket_size = curr_bucket.size();
-                    int chunk_size = (curr_bucket_size + num_threads - 1) / num_threads;
-                    for (int idx = 0; idx < num_threads; ++idx) {
-                        int start = idx * chunk_size;
-                        int end = start + chunk_size;
-                        if (end > curr_bucket_size) {
-                            end = curr_bucket_size;
+                    // Loop 1: request generation, together with the carried heavy requests in pipelined mode
+                    SegmentedVector<int> &curr_bucket = buckets[current_generation];
+                    const size_t bucket_size = curr_bucket.size();
+                    ws.run_phase(inline_policy, bucket_size + carried, GENERATION_GRAIN, [&] {
+                        return ws.bucket_edges(curr_bucket);
+                    }, [&] (size_t tid, size_t first, size_t last) {
+                        if (last > bucket_size) {
+                            ws.carried_heavy_requests.for_each(std::max(first, bucket_size) - bucket_size, last - bucket_size, [&] (int request_node) {
+                                ws.relax_carried(request_node, tid, fusion_limit);
+                            });
+                            last = bucket_size;
                         }
-                        pool.push(idx, [&, start, end] {
-                            for (int idx_u = start; idx_u < end; ++idx_u) {
-                                int u = curr_bucket[idx_u];
-                                if (u >= 0) {
-                                    gen_light_request(u);
-                                    gen_heavy_request(u);
+                        for (size_t idx_u = first; idx_u < last; ++idx_u) {
+                            int u = curr_bucket[idx_u];
+                            if (u >= 0) {
+                                if (options.dynamic_split) {
+                                    ws.gen_light_request_dynamic(u, tid);
                                 }
+                                else {
+                                    ws.gen_light_request(u, tid);
+                                }
+                                ws.gen_heavy_request(u, tid);
                             }
-                        });
-                    }
-                    barrier.arrive_and_wait(); // manual sync
+                        }
+                    }, [&] (size_t tid) {
+                        if (carried > 0) {
+                            flush(tid);
+                        }
+                    });
 
-                    curr_bucket.clear();
+                    ws.clear_bucket(current_generation);
+                    if (carried > 0) {
+                        ws.drop_carried_heavy_requests();
+                        carried = 0;
+                    }
                 }
 
 
-                // Loop 2: relax light edges
+                // Loop 2: relax light edges (and, in bucket fusion mode, the light edges of the vertices this reaches)
                 {
-                    // std::cerr << "loop2\n";
-                    int requests_size = light_nodes_counter;
-                    int chunk_size = (requests_size + num_threads - 1) / num_threads;
-                    for (int idx = 0; idx < num_threads; ++idx) {
-                        int start = idx * chunk_size;
-                        int end = start + chunk_size;
-                        if (end > requests_size) {
-                            end = requests_size;
-                        }
-                        pool.push(idx, [&, start, end] {
-                            for (int idx_r = start; idx_r < end; ++idx_r) {
-                                int request_node = light_nodes_requested[idx_r];
-                                relax(request_node, light_request_map);
-                            }
+                    size_t count = light_requests.scan();
+                    ++ws.light_rounds;
+                    ws.light_relaxations += count;
+                    ws.run_phase(inline_policy, count, RELAX_GRAIN, no_edges, [&] (size_t tid, size_t first, size_t last) {
+                        light_requests.for_each(first, last, [&] (int request_node) {
+                            relax(request_node, ws.light_requested, tid);
                         });
-                    }
-                    barrier.arrive_and_wait();
+                    }, flush);
 
-                    light_nodes_counter = 0;
+                    light_requests.clear();
                 }
             }
             
-            // Loop 3: relax heavy edges
-            {
-                int requests_size = heavy_nodes_counter;
-                int chunk_size = (requests_size + num_threads - 1) / num_threads;
-                for (int idx = 0; idx < num_threads; ++idx) {
-                    int start = idx * chunk_size;
-                    int end = start + chunk_size;
-                    if (end > requests_size) {
-                        end = requests_size;
-                    }
-                    pool.push(idx, [&, start, end] {
-                        for (int idx_r = start; idx_r < end; ++idx_r) {
-                            int request_node = heavy_nodes_requested[idx_r];
-                            relax(request_node, heavy_request_map);
-                        }
+            // Loop 3: relax heavy edges, park them until their bucket comes up, or carry them to the next bucket
+            if (pipelined) {
+                carried = ws.carry_heavy_requests();
+            }
+            else if (options.defer_heavy) {
+                ws.run_phase(inline_policy, heavy_requests.scan(), RELAX_GRAIN, no_edges, [&] (size_t tid, size_t first, size_t last) {
+                    heavy_requests.for_each(first, last, [&] (int request_node) {
+                        ws.park(request_node, tid);
                     });
-                }
-                barrier.arrive_and_wait();
+                }, [] (size_t) {});
 
-                heavy_nodes_counter = 0;
+                heavy_requests.clear();
             }
-        }
+            else {
+                // no bucket fusion here: fuse() would append to the heavy request lists this phase reads, so a
+                // target that rounds into the current bucket goes back into the bucket (fusion limit 0)
+                ws.run_phase(inline_policy, heavy_requests.scan(), RELAX_GRAIN, no_edges, [&] (size_t tid, size_t first, size_t last) {
+                    heavy_requests.for_each(first, last, [&] (int request_node) {
+                        bool improved = fusion_limit > 0 ? ws.relax_fused(request_node, ws.heavy_requested, tid, 0)
+                                                         : ws.relax(request_node, ws.heavy_requested, tid);
+                        ws.count_heavy_relaxation(tid, improved);
+                    });
+                }, [&] (size_t tid) {
+                    ws.flush_bucket_blocks(tid);
+                });
 
-        pool.stop();
+                heavy_requests.clear();
+            }
 
-        return dist;
+            // carried requests are relaxed with the next bucket's request generation, whether it has vertices or not
+            current_generation = carried > 0 ? ws.following_bucket(current_generation) : ws.next_bucket(current_generation);
+        }
+
+        return ws.distances();
     }
 private:
+    // bucket entries / requests per parallel_for chunk
+    static constexpr size_t GENERATION_GRAIN = 64;
+    static constexpr size_t RELAX_GRAIN = 256;
+
     double delta;
     int num_threads;
+    DeltaSteppingOptions options;
+    mutable WorkspaceCache<Workspace> workspace_cache;
 };
 
+using DeltaSteppingParallel = DeltaSteppingParallelT<SplitVertexState>;
+using DeltaSteppingParallelPacked = DeltaSteppingParallelT<PackedVertexState>;
+using DeltaSteppingParallelTwoLevel = DeltaSteppingParallelT<SplitVertexState, TwoLevelBuckets<>>;
+
 #endif
\ No newline at end of file
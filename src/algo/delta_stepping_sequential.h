@@ -18,17 +18,9 @@ public:
         int n = graph.size();
         std::vector<double> dist(n, INF_MAX);
 
-        std::vector<std::vector<AdjEdge>> heavy(n), light(n);
-        for (int u = 0; u < n; ++u) {
-            for (const auto &[v, w] : graph[u]) {
-                if (w < delta) {
-                    light[u].push_back({v, w});
-                }
-                else {
-                    heavy[u].push_back({v, w});
-                }
-            }
-        }
+        // light / heavy edges are filtered in place; rows sorted by weight end their light scan
+        // at the first heavy edge and start their heavy scan there
+        bool sorted_by_weight = graph.neighbor_order() == NeighborOrder::BY_WEIGHT;
 
         // FURTHER RESEARCH: more memory efficient implementation of buckets (linked list instead of vector?)
         std::vector<std::unordered_set<int>> buckets(1);
@@ -64,15 +56,24 @@ public:
                 buckets[i].clear();
                 // we can combine light edge relaxation with request generation
                 for (const int &u : curr_bucket) {
-                    for (const auto &[v, w] : light[u]) {
-                        relax(u, v, w);
+                    for (const auto &[v, w] : graph[u]) {
+                        if (w < delta) {
+                            relax(u, v, w);
+                        }
+                        else if (sorted_by_weight) {
+                            break;
+                        }
                     }
                     S.insert(u); // strictest request optimization; change back to r_heavy if needed
                 }
             }
             for (const int &u : S) {
-                for (const auto &[v, w] : heavy[u]) {
-                    relax(u, v, w);
+                AdjacencyRange adj = graph[u];
+                for (size_t k = sorted_by_weight ? graph.light_degree(u, delta) : 0; k < adj.size(); ++k) {
+                    auto [v, w] = adj[k];
+                    if (w >= delta) {
+                        relax(u, v, w);
+                    }
                 }
             }
             S.clear();
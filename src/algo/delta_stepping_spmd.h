@@ -0,0 +1,132 @@
+#ifndef DELTA_STEPPING_SPMD_H
+#define DELTA_STEPPING_SPMD_H
+
+#include "shortest_path_solver_base.h"
+#include "pools/fixed_task_pool.h"
+#include "lists/segmented_vector.h"
+#include "delta_stepping_workspace.h"
+#include <algorithm>
+
+// Delta stepping in SPMD style: the pool workers and the calling thread all run the whole bucket loop
+// in lockstep instead of the calling thread handing every phase to the pool. Each participant works on a
+// static share of every phase, computed alone from sizes read after a barrier, and the participants meet
+// only at the pool barrier between phases. A bucket is consumed from a local offset rather than cleared
+// every round, and cleared as a whole during the first phase of the next bucket.
+class DeltaSteppingSpmd : public ShortestPathSolverBase {
+public:
+    const std::string name() const override {
+        return "Parallel delta stepping (SPMD)";
+    }
+
+    DeltaSteppingSpmd(double delta, int num_threads): delta(delta), num_threads(num_threads) {}
+
+    using Workspace = DeltaSteppingWorkspace<SegmentedVector<int>, FixedTaskPool>;
+
+    std::vector<double> compute(const Graph &graph, int source) const override {
+        return solve(workspace_cache.get(graph, delta, num_threads), source);
+    }
+
+    void release_workspace() const override {
+        workspace_cache.release();
+    }
+
+    std::vector<std::pair<std::string, uint64_t>> last_query_counters() const override {
+        return workspace_cache.counters();
+    }
+
+    // Run one query on a workspace bound to the graph; the result stays valid until the next query on it
+    std::vector<double> solve(Workspace &ws, int source) const {
+        ws.reset(source);
+        ws.pool.run_spmd([&] (size_t tid) {
+            run(ws, tid);
+        });
+        // the last bucket is consumed but not cleared yet
+        ws.clear_bucket(ws.current_generation);
+        return ws.distances();
+    }
+
+private:
+    double delta;
+    int num_threads;
+    mutable WorkspaceCache<Workspace> workspace_cache;
+
+    // The bucket loop of one participant. Every decision depends only on state read after a barrier,
+    // so all participants take the same branches and call sync() equally often.
+    void run(Workspace &ws, size_t tid) const {
+        FixedTaskPool &pool = ws.pool;
+        const size_t participants = pool.size() + 1;
+        const bool leader = tid == pool.size();
+        std::vector<SegmentedVector<int>> &buckets = ws.buckets;
+        ThreadLocalLists<int> &light_requests = ws.light_requests, &heavy_requests = ws.heavy_requests;
+
+        // the consumed bucket of the previous generation, cleared by the leader in the next request generation
+        int consumed = -1;
+        int generation = 0;
+        while (generation >= 0) {
+            SegmentedVector<int> &curr_bucket = buckets[generation];
+            if (leader) {
+                // read only in the relaxation phases, after the next barrier
+                ws.current_generation = generation;
+            }
+            // entries before begin are done; relaxations only append to the bucket, and only the leader
+            // clears it, after every participant found it empty
+            size_t begin = 0;
+            while (curr_bucket.size() > begin) {
+                // Loop 1: request generation over a share of the new entries
+                size_t end = curr_bucket.size();
+                for (size_t idx_u = begin + tid * (end - begin) / participants;
+                     idx_u < begin + (tid + 1) * (end - begin) / participants; ++idx_u) {
+                    int u = curr_bucket[idx_u];
+                    if (u >= 0) {
+                        ws.gen_light_request(u, tid);
+                        ws.gen_heavy_request(u, tid);
+                    }
+                }
+                if (leader && consumed >= 0) {
+                    // nothing pushes during request generation
+                    ws.clear_bucket(consumed);
+                    consumed = -1;
+                }
+                begin = end;
+                pool.sync(tid);
+
+                // Loop 2: relax light edges. The list totals are read before the next barrier, behind which
+                // participants that are ahead already generate the requests of the next round.
+                size_t light_total = light_requests.size(), heavy_total = heavy_requests.size();
+                if (leader) {
+                    ++ws.light_rounds;
+                    ws.light_relaxations += light_total;
+                }
+                light_requests.for_each_share(tid, participants, light_total, [&] (int request_node) {
+                    ws.relax(request_node, ws.light_requested, tid);
+                });
+                ws.flush_bucket_blocks(tid);
+                pool.sync(tid);
+                light_requests.clear(tid);
+
+                // Loop 3: relax heavy edges once the bucket stays empty. A leader that is ahead may already
+                // have cleared it for the next bucket, which reads as empty as well.
+                if (heavy_total > 0 && curr_bucket.size() <= begin) {
+                    // rounding can put a heavy target back into the current bucket, so nobody may push
+                    // before every participant has seen that bucket empty
+                    pool.sync(tid);
+                    heavy_requests.for_each_share(tid, participants, heavy_total, [&] (int request_node) {
+                        ws.relax(request_node, ws.heavy_requested, tid);
+                    });
+                    ws.flush_bucket_blocks(tid);
+                    pool.sync(tid);
+                    heavy_requests.clear(tid);
+                    // entries the rounding put back make another round of the same bucket
+                }
+            }
+
+            // the consumed bucket is still marked occupied, so it comes last in ring order: no other
+            // occupied bucket means the query is done
+            consumed = generation;
+            int next = ws.next_bucket(generation);
+            generation = next == consumed ? -1 : next;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,835 @@
+#ifndef DELTA_STEPPING_WORKSPACE_H
+#define DELTA_STEPPING_WORKSPACE_H
+
+#include "graph.h"
+#include "lists/segmented_vector.h"
+#include "lists/thread_local_lists.h"
+#include "lists/first_touch_array.h"
+#include "atomics/atomic_min_double.h"
+#include "vertex_state.h"
+#include "bucket_policy.h"
+#include "atomics/concurrent_bitmap.h"
+#include "atomics/hierarchical_bitmap.h"
+#include <vector>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <cmath>
+#include <type_traits>
+#include <string>
+#include <utility>
+#include <algorithm>
+
+// When a solver phase is small enough to run on the calling thread (as task 0) instead of waking the pool:
+// at most max_vertices bucket entries or requests, whose out-degrees sum to at most max_edges.
+// Phases with nothing to do always run inline; {0, 0} keeps every other phase on the pool.
+struct InlinePolicy {
+    size_t max_vertices = 64;
+    size_t max_edges = 1024;
+};
+
+// Per-graph state of the parallel delta-stepping solvers, kept alive between queries.
+// Binding a workspace to (graph, delta, num_threads) pays once for the light/heavy split,
+// the vertex-indexed arrays, the buckets and the worker threads. reset() only undoes the
+// entries the previous query touched, so per-query setup is proportional to the vertices reached.
+// Request maps, request lists and buckets are left empty by every completed query.
+// Vertex-indexed arrays (and the light/heavy copies of the edges) are first written by the pool worker
+// owning each vertex block, so with pinned workers every socket holds the pages of its own block.
+// Methods taking a tid are called from pool tasks: tid is the index of the calling task (0 .. num_threads - 1,
+// or num_threads for the calling thread of an SPMD phase), unique among the tasks of a phase. It selects the task's own request list and bucket blocks,
+// so appends never go through a counter shared by all threads.
+// NOT THREAD-SAFE: one query at a time.
+template<class BucketType, class PoolType, class VertexState = SplitVertexState, class BucketPolicy = RingBuckets>
+class DeltaSteppingWorkspace {
+public:
+    using Request = Edge;
+
+    static constexpr double INF_MAX = std::numeric_limits<double>::infinity();
+    // slots a task claims at once in a bucket that supports reserve_block(), and how many such blocks it keeps open
+    static constexpr size_t BUCKET_BLOCK_SIZE = 16;
+    static constexpr size_t OPEN_BLOCKS_PER_TASK = 64;
+
+    DeltaSteppingWorkspace(const Graph &graph, double delta, size_t num_threads, bool split_by_weight = true):
+        graph(graph),
+        graph_id(graph.id()),
+        delta(delta),
+        num_threads(num_threads),
+        bucket_policy(delta, graph.get_max_edge_weight()),
+        max_bucket_count(bucket_policy.count()),
+        vertices(graph.size()),
+        occupied(max_bucket_count),
+        light_requested(graph.size()),
+        heavy_requested(graph.size()),
+        light_requests(num_threads + 1),
+        heavy_requests(num_threads + 1),
+        carried_heavy_requests(num_threads + 1),
+        touched(graph.size()),
+        pool(num_threads),
+        bucket_blocks(num_threads + 1),
+        task_counters(num_threads + 1),
+        fusion_queues(num_threads + 1) {
+        int n = graph.size();
+
+        buckets.reserve(max_bucket_count);
+        for (int i = 0; i < max_bucket_count; ++i) {
+            if constexpr (std::is_constructible_v<BucketType, SegmentPool<int>&>) {
+                buckets.emplace_back(segment_pool);
+            }
+            else if constexpr (std::is_constructible_v<BucketType, size_t>) {
+                buckets.emplace_back(n);
+            }
+            else {
+                buckets.emplace_back();
+            }
+        }
+
+        // a weight-sorted graph is split in place: only the index of the first heavy edge of every row is kept.
+        // When the workers span several NUMA nodes the edges are copied instead, so every block is local to its owner.
+        bool in_place = split_by_weight && graph.neighbor_order() == NeighborOrder::BY_WEIGHT && num_nodes() == 1;
+        if (in_place) {
+            light_end = FirstTouchArray<size_t>(n);
+        }
+        for_each_block(n, [&] (size_t, size_t first, size_t last) {
+            vertices.construct(first, last, INF_MAX, -1);
+            touched.construct(first, last, 0);
+            if (in_place) {
+                const size_t *offsets = graph.offset_data();
+                for (size_t u = first; u < last; ++u) {
+                    light_end.construct(u, u + 1, offsets[u] + graph.light_degree(u, delta));
+                }
+            }
+        });
+        if (split_by_weight && !in_place) {
+            light = split_edges(true);
+            heavy = split_edges(false);
+        }
+    }
+
+    DeltaSteppingWorkspace(const DeltaSteppingWorkspace&) = delete;
+    DeltaSteppingWorkspace& operator=(const DeltaSteppingWorkspace&) = delete;
+
+    bool is_bound_to(const Graph &other) const {
+        return &other == &graph && other.id() == graph_id;
+    }
+
+    // Undo the previous query and seed a new one from source
+    void reset(int source) {
+        size_t touched_count = touched_counter;
+        for (size_t i = 0; i < touched_count; ++i) {
+            int v = touched[i];
+            vertices.dist(v) = INF_MAX;
+            vertices.position(v) = -1;
+        }
+        touched_counter = 0;
+        light_requests.clear();
+        heavy_requests.clear();
+        carried_heavy_requests.clear();
+        carrying = false;
+        std::fill(task_counters.begin(), task_counters.end(), TaskCounters());
+        light_rounds = 0;
+        light_relaxations = 0;
+        inline_phases = 0;
+        pool_phases = 0;
+        if constexpr (requires (PoolType &p) { p.reset_steal_count(); }) {
+            pool.reset_steal_count();
+        }
+        current_generation = 0;
+        occupied.clear();
+        bucket_policy.reset();
+
+        vertices.dist(source) = 0;
+        vertices.position(source) = push_to_bucket(bucket_of(0), source);
+        touched[touched_counter++] = source;
+    }
+
+    // distances of the current (or last) query
+    std::vector<double> distances() const {
+        std::vector<double> result(graph.size());
+        for (int v = 0; v < graph.size(); ++v) {
+            result[v] = vertices.dist(v);
+        }
+        return result;
+    }
+
+    int get_bucket(int v) const {
+        if (vertices.dist(v) == INF_MAX) {
+            return -1;
+        }
+        return bucket_of(vertices.dist(v));
+    }
+
+    // bucket of a finite distance
+    int bucket_of(double distance) const {
+        return bucket_policy.bucket_of(distance);
+    }
+
+    size_t push_to_bucket(int bucket, int v) {
+        occupied.set(bucket);
+        if constexpr (requires (BucketType &b, int x) { b.push(x); }) {
+            return buckets[bucket].push(v);
+        }
+        else {
+            return buckets[bucket].push_back(v) - 1;
+        }
+    }
+
+    // Append v to a bucket from a task: slots are claimed BUCKET_BLOCK_SIZE at a time per (task, bucket),
+    // the task must call flush_bucket_blocks() before its phase ends
+    size_t push_to_bucket(int bucket, int v, size_t tid) {
+        if constexpr (requires (BucketType &b, size_t count) { b.reserve_block(count); }) {
+            BucketBlock &block = bucket_blocks[tid].blocks[bucket % OPEN_BLOCKS_PER_TASK];
+            if (block.bucket != bucket || block.next == block.end) {
+                close_block(block);
+                block.bucket = bucket;
+                block.next = buckets[bucket].reserve_block(BUCKET_BLOCK_SIZE);
+                occupied.set(bucket);
+                block.end = block.next + BUCKET_BLOCK_SIZE;
+            }
+            buckets[bucket][block.next] = v;
+            return block.next++;
+        }
+        else {
+            return push_to_bucket(bucket, v);
+        }
+    }
+
+    // Fill the unused slots of the task's open blocks with -1 (the empty-slot marker of the buckets)
+    void flush_bucket_blocks(size_t tid) {
+        for (BucketBlock &block : bucket_blocks[tid].blocks) {
+            close_block(block);
+        }
+    }
+
+    // Empty bucket b and drop its occupancy bit, between phases only
+    void clear_bucket(int b) {
+        buckets[b].clear();
+        occupied.reset(b);
+    }
+
+    // The first bucket after b in ring order (b itself last) that was pushed to since it was last cleared,
+    // -1 if there is none and the query is done. Between phases only.
+    // Two-level buckets: the first such fine bucket, moving the window on when there is none.
+    int next_bucket(int b) {
+        if constexpr (BucketPolicy::TWO_LEVEL) {
+            while (true) {
+                size_t next = occupied.find_next(b + 1);
+                if (next >= BucketPolicy::FINE) {
+                    next = occupied.find_next(0);
+                }
+                if (next < BucketPolicy::FINE) {
+                    return int(next);
+                }
+                if (!advance_window()) {
+                    return -1;
+                }
+                b = -1;
+            }
+        }
+        else {
+            size_t next = occupied.find_next_cyclic(b);
+            return next == HierarchicalBitmap::NONE ? -1 : int(next);
+        }
+    }
+
+    // The bucket after b whatever it holds, for requests that are still to be applied to it.
+    // Two-level buckets: past the last fine bucket the window moves on by one block.
+    int following_bucket(int b) {
+        if constexpr (BucketPolicy::TWO_LEVEL) {
+            if (b + 1 == BucketPolicy::FINE) {
+                move_window(bucket_policy.window_block + 1);
+            }
+        }
+        return bucket_policy.successor(b);
+    }
+
+    // Apply the pending request of v and drop v from the requested set of its list.
+    // Runs in a phase of its own: nothing adds requests meanwhile and v is relaxed by one task,
+    // so taking the value needs no read-modify-write.
+    // Returns whether dist(v) dropped.
+    bool relax(int v, ConcurrentBitmap &requested, size_t tid) {
+        double new_distance = vertices.request(v).load();
+        vertices.request(v).store(INF_MAX);
+        requested.reset(v);
+        return apply_distance(v, new_distance, tid);
+    }
+
+    // Lower dist(v) to new_distance if that is smaller and move v to its new bucket, the second half of relax()
+    bool apply_distance(int v, double new_distance, size_t tid) {
+        // note: during light edge relaxation, multiple readers - one writer can happen
+        // but that is fine, because the next epoch will take care of this concurrency issue
+        if (new_distance < vertices.dist(v)) {
+            int old_bucket = get_bucket(v);
+            vertices.dist(v) = new_distance;
+            int new_bucket = get_bucket(v);
+            if (old_bucket == -1) {
+                touched[touched_counter.fetch_add(1)] = v;
+            }
+            if (old_bucket != -1 && old_bucket != current_generation && old_bucket != new_bucket) { // since current generation bucket is always cleared
+                buckets[old_bucket][vertices.position(v)] = -1;
+            }
+            if (old_bucket == current_generation || old_bucket != new_bucket) {
+                vertices.position(v) = push_to_bucket(new_bucket, v, tid);
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // Pipelined heavy relaxation: hand the heavy requests of the bucket just settled over to the request
+    // generation of the next one, which collects its own heavy requests in a fresh list. Returns their number.
+    size_t carry_heavy_requests() {
+        std::swap(heavy_requests, carried_heavy_requests);
+        heavy_requests.clear();
+        size_t count = carried_heavy_requests.scan();
+        carrying = count > 0;
+        return count;
+    }
+
+    // Drop the carried heavy requests once the request generation that relaxed them is over
+    void drop_carried_heavy_requests() {
+        carried_heavy_requests.clear();
+        carrying = false;
+    }
+
+    // Relax a carried heavy request of v while the current bucket generates its requests. A request that
+    // falls into the current bucket becomes a light request of it, relaxed with the others after the phase;
+    // any other one cannot touch a vertex of the current bucket and is applied right away.
+    // The bit is reset before the slot is taken, so a heavy request for v generated meanwhile is either
+    // taken here or pushed to the new list. All of it is relaxed, so both sides need a seq_cst fence between
+    // their two steps (here and in request_distance()); without them each could miss the other's write.
+    void relax_carried(int v, size_t tid, size_t fusion_limit) {
+        heavy_requested.reset(v);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        double new_distance = vertices.request(v).take();
+        if (new_distance == INF_MAX) {
+            count_heavy_relaxation(tid, false); // applied by a light relaxation already
+            return;
+        }
+        if (bucket_of(new_distance) == current_generation) {
+            request_distance(light_requests, light_requested, v, new_distance, tid);
+            ++task_counters[tid].carried_light_requests;
+            return;
+        }
+        bool improved = fusion_limit > 0 ? lower_distance(v, new_distance, tid, fusion_limit) : apply_distance(v, new_distance, tid);
+        count_heavy_relaxation(tid, improved);
+    }
+
+    // Bucket fusion variant of relax(), safe while other tasks lower distances of the same vertices.
+    // A vertex that stays in the current bucket goes to the task's fusion queue (up to fusion_limit
+    // vertices per phase), to be reprocessed by fuse() before the phase ends instead of in another round.
+    // Bucket entries are never invalidated in this mode: a stale entry only makes its vertex scan its edges again.
+    // A query must use either relax() or relax_fused(), not both.
+    bool relax_fused(int v, ConcurrentBitmap &requested, size_t tid, size_t fusion_limit) {
+        double new_distance = vertices.request(v).take();
+        requested.reset(v);
+        return lower_distance(v, new_distance, tid, fusion_limit);
+    }
+
+    // Deferred heavy relaxation: move v from the heavy request list to the parked list of the bucket its
+    // pending request falls in. The request stays in v's slot, where later requests for v merge into it,
+    // and is applied by relax() once that bucket comes up, or earlier by a light relaxation of v.
+    void park(int v, size_t tid) {
+        heavy_requested.reset(v);
+        double distance = vertices.request(v).load();
+        if (distance == INF_MAX) {
+            return; // applied by a light relaxation already
+        }
+        // w >= delta, but the division can round the target down into the current bucket, which has been
+        // processed already: apply such a request with the next one
+        int bucket = bucket_of(distance);
+        if (bucket == current_generation) {
+            bucket = bucket_policy.successor(bucket);
+        }
+        parked[bucket].push(tid, v);
+        occupied.set(bucket);
+        ++task_counters[tid].parked_requests;
+    }
+
+    // Create the parked lists of every bucket, before the first query that parks requests
+    void enable_parking() {
+        if (parked.empty()) {
+            parked.reserve(max_bucket_count);
+            for (int b = 0; b < max_bucket_count; ++b) {
+                parked.emplace_back(num_threads + 1);
+            }
+        }
+    }
+
+    // Vertices with a request parked for bucket, nullptr until enable_parking()
+    ThreadLocalLists<int> *parked_for(int bucket) {
+        return parked.empty() ? nullptr : &parked[bucket];
+    }
+
+    // count a relaxation of a heavy request, improved tells whether it lowered a distance
+    void count_heavy_relaxation(size_t tid, bool improved) {
+        ++task_counters[tid].heavy_relaxations;
+        task_counters[tid].wasted_heavy_relaxations += !improved;
+    }
+
+    // Relax the light edges of the vertices queued by relax_fused() and generate their heavy requests,
+    // repeating for the vertices this reaches in the current bucket. Call at the end of the task's phase,
+    // before flush_bucket_blocks().
+    void fuse(size_t tid, size_t fusion_limit) {
+        std::vector<int> &queue = fusion_queues[tid].items;
+        while (!queue.empty()) {
+            int u = queue.back();
+            queue.pop_back();
+            double du = std::atomic_ref<double>(vertices.dist(u)).load(std::memory_order_relaxed);
+            for (const auto &[v, w] : light_edges(u)) {
+                lower_distance(v, du + w, tid, fusion_limit);
+            }
+            for (const auto &[v, w] : heavy_edges(u)) {
+                if (du + w < std::atomic_ref<double>(vertices.dist(v)).load(std::memory_order_relaxed)) {
+                    request_distance(heavy_requests, heavy_requested, v, du + w, tid);
+                }
+            }
+            ++task_counters[tid].fused_vertices;
+        }
+        fusion_queues[tid].accepted = 0;
+    }
+
+    // Strictest request optimization -- No mutexes
+    // Light and heavy requests share one slot per vertex holding the smallest pending distance:
+    // any request value is a valid path length, so whichever phase relaxes v first may apply it,
+    // and a later phase finds the slot empty. The bitmaps only keep each list free of duplicates.
+    // Once v is in the list a request is a single write_min, which returns without writing if it does not improve.
+    void add_request(ThreadLocalLists<int> &requested_nodes, ConcurrentBitmap &requested, const Request &request, size_t tid) {
+        request_distance(requested_nodes, requested, request.v, vertices.dist(request.u) + request.w, tid);
+    }
+
+    void request_distance(ThreadLocalLists<int> &requested_nodes, ConcurrentBitmap &requested, int v, double new_distance, size_t tid) {
+        vertices.request(v).write_min(new_distance, task_counters[tid].write_min_retries);
+        if (carrying) {
+            // pairs with the fence of relax_carried(), which may be taking this slot right now
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+        if (!requested.test_and_set(v)) {
+            requested_nodes.push(tid, v);
+        }
+    }
+
+    void add_light_request(int u, int v, double w, size_t tid) {
+        add_request(light_requests, light_requested, Request{u, v, w}, tid);
+    }
+
+    void add_heavy_request(int u, int v, double w, size_t tid) {
+        add_request(heavy_requests, heavy_requested, Request{u, v, w}, tid);
+    }
+
+    // Whether a phase over count items runs inline under policy; edges() sums their out-degrees and
+    // is only called for phases of at most policy.max_vertices items. Counts the decision.
+    template<class Edges>
+    bool run_inline(const InlinePolicy &policy, size_t count, Edges &&edges) {
+        bool small = count == 0 || (count <= policy.max_vertices && edges() <= policy.max_edges);
+        ++(small ? inline_phases : pool_phases);
+        return small;
+    }
+
+    // pool.parallel_for(0, count, grain, body, finish), or body and finish as task 0 on the calling thread
+    // if run_inline() says so
+    template<class Edges, class Body, class Finish>
+    void run_phase(const InlinePolicy &policy, size_t count, size_t grain, Edges &&edges, Body &&body, Finish &&finish) {
+        if (run_inline(policy, count, edges)) {
+            if (count > 0) {
+                body(size_t(0), size_t(0), count);
+            }
+            finish(size_t(0));
+        }
+        else {
+            pool.parallel_for(0, count, grain, body, finish);
+        }
+    }
+
+    // out-edges of the vertices in bucket
+    size_t bucket_edges(const BucketType &bucket) const {
+        size_t edges = 0;
+        for (size_t i = 0; i < bucket.size(); ++i) {
+            int u = bucket[i];
+            if (u >= 0) {
+                edges += graph.degree(u);
+            }
+        }
+        return edges;
+    }
+
+    // Event counters of the current (or last) query, summed over the tasks
+    std::vector<std::pair<std::string, uint64_t>> counters() const {
+        uint64_t write_min_retries = 0, fused_vertices = 0, parked_requests = 0, heavy_relaxations = 0, wasted_heavy_relaxations = 0;
+        uint64_t deferred_light_edges = 0, carried_light_requests = 0;
+        for (const TaskCounters &task : task_counters) {
+            write_min_retries += task.write_min_retries;
+            fused_vertices += task.fused_vertices;
+            parked_requests += task.parked_requests;
+            heavy_relaxations += task.heavy_relaxations;
+            wasted_heavy_relaxations += task.wasted_heavy_relaxations;
+            deferred_light_edges += task.deferred_light_edges;
+            carried_light_requests += task.carried_light_requests;
+        }
+        std::vector<std::pair<std::string, uint64_t>> result = {
+            {"write_min_retries", write_min_retries}, {"light_rounds", light_rounds}, {"light_relaxations", light_relaxations},
+            {"deferred_light_edges", deferred_light_edges}, {"fused_vertices", fused_vertices},
+            {"inline_phases", inline_phases}, {"pool_phases", pool_phases}, {"parked_requests", parked_requests},
+            {"heavy_relaxations", heavy_relaxations}, {"wasted_heavy_relaxations", wasted_heavy_relaxations},
+            {"carried_light_requests", carried_light_requests}};
+        if constexpr (requires (const PoolType &p) { p.steal_count(); }) {
+            result.emplace_back("steals", pool.steal_count());
+        }
+        return result;
+    }
+
+    // light / heavy out-edges of u, views into the graph itself when it is sorted by weight
+    AdjacencyRange light_edges(int u) const {
+        if (light_end.empty()) {
+            return light[u];
+        }
+        size_t begin = graph.offset_data()[u];
+        return AdjacencyRange(graph.target_data() + begin, graph.weight_data() + begin, light_end[u] - begin);
+    }
+
+    AdjacencyRange heavy_edges(int u) const {
+        if (light_end.empty()) {
+            return heavy[u];
+        }
+        size_t end = graph.offset_data()[u + 1];
+        return AdjacencyRange(graph.target_data() + light_end[u], graph.weight_data() + light_end[u], end - light_end[u]);
+    }
+
+    void gen_light_request(int u, size_t tid) {
+        for (const auto &[v, w] : light_edges(u)) {
+            if (vertices.dist(u) + w < vertices.dist(v)) {
+                add_light_request(u, v, w, tid);
+            }
+        }
+    }
+
+    // Dynamic light/heavy split: a light edge goes to the light requests only if its target distance stays in
+    // the current bucket. Any other one would only move its target to a later bucket, so it is deferred to the
+    // heavy requests, which are relaxed once the current bucket is settled.
+    void gen_light_request_dynamic(int u, size_t tid) {
+        for (const auto &[v, w] : light_edges(u)) {
+            double new_distance = vertices.dist(u) + w;
+            if (new_distance < vertices.dist(v)) {
+                if (bucket_of(new_distance) == current_generation) {
+                    add_light_request(u, v, w, tid);
+                }
+                else {
+                    if (new_distance < vertices.request(v).load()) {
+                        add_heavy_request(u, v, w, tid);
+                    }
+                    ++task_counters[tid].deferred_light_edges;
+                }
+            }
+        }
+    }
+
+    // A heavy request that does not beat the pending one of v is dropped: with deferred heavy relaxation
+    // requests wait in the slot for many buckets, and the later ones for the same target merge into it here.
+    void gen_heavy_request(int u, size_t tid) {
+        for (const auto &[v, w] : heavy_edges(u)) {
+            double new_distance = vertices.dist(u) + w;
+            if (new_distance < vertices.dist(v) && new_distance < vertices.request(v).load()) {
+                add_heavy_request(u, v, w, tid);
+            }
+        }
+    }
+
+    const Graph &graph;
+    const uint64_t graph_id;
+    const double delta;
+    const size_t num_threads;
+    // maps distances to buckets, holds the window of the two-level buckets
+    BucketPolicy bucket_policy;
+    const int max_bucket_count;
+
+    // split_by_weight on a graph sorted BY_WEIGHT: the light edges of u end at light_end[u] (an edge index)
+    FirstTouchArray<size_t> light_end;
+    // split_by_weight on any other graph: copies of the light / heavy out-edges of every vertex
+    Graph light{0, {}}, heavy{0, {}};
+
+    // distance, pending request and bucket position of every vertex
+    VertexState vertices;
+    // shared by segmented buckets, must outlive them
+    SegmentPool<int> segment_pool;
+    std::vector<BucketType> buckets;
+    // buckets pushed to (or with parked requests) since they were last cleared, see next_bucket()
+    HierarchicalBitmap occupied;
+
+    // whether a vertex is already in the light / heavy request lists
+    ConcurrentBitmap light_requested, heavy_requested;
+    // vertices with a pending light / heavy request, one list per task (and one for the calling thread)
+    ThreadLocalLists<int> light_requests, heavy_requests;
+    // pipelined heavy relaxation: heavy requests of the previous bucket, see carry_heavy_requests()
+    ThreadLocalLists<int> carried_heavy_requests;
+    // whether carried heavy requests are being relaxed alongside request generation
+    bool carrying = false;
+
+    // vertices whose distance became finite during the current query
+    FirstTouchArray<int> touched;
+    std::atomic<size_t> touched_counter{0};
+
+    int current_generation = 0;
+    // light relaxation phases of the current query and the requests they relaxed, counted by the solver
+    uint64_t light_rounds = 0, light_relaxations = 0;
+    // phases run on the calling thread / on the pool, see run_inline()
+    uint64_t inline_phases = 0, pool_phases = 0;
+
+    // scratch space of the load-balanced variants (edge prefix over the current bucket)
+    std::vector<size_t> prefix;
+
+    PoolType pool;
+
+private:
+    struct BucketBlock {
+        int bucket = -1;
+        size_t next = 0, end = 0;
+    };
+
+    // open blocks of one task, direct-mapped by bucket index
+    struct alignas(64) TaskBlocks {
+        BucketBlock blocks[OPEN_BLOCKS_PER_TASK];
+    };
+
+    std::vector<TaskBlocks> bucket_blocks;
+
+    struct alignas(64) TaskCounters {
+        uint64_t write_min_retries = 0;
+        uint64_t fused_vertices = 0;
+        uint64_t parked_requests = 0;
+        uint64_t heavy_relaxations = 0;
+        uint64_t wasted_heavy_relaxations = 0; // found a distance at least as good
+        uint64_t deferred_light_edges = 0;
+        uint64_t carried_light_requests = 0;
+    };
+
+    std::vector<TaskCounters> task_counters;
+
+    // same-bucket vertices a task reprocesses itself in bucket fusion mode
+    struct alignas(64) FusionQueue {
+        std::vector<int> items;
+        size_t accepted = 0; // vertices queued during the current phase
+    };
+
+    std::vector<FusionQueue> fusion_queues;
+
+    // heavy requests parked by target bucket (deferred heavy relaxation), one list per task
+    std::vector<ThreadLocalLists<int>> parked;
+    // scratch list of move_window()
+    std::vector<int> moved;
+
+    // Lower dist(v) to new_distance with a CAS loop and put v where it will be scanned again.
+    // Returns whether dist(v) dropped.
+    bool lower_distance(int v, double new_distance, size_t tid, size_t fusion_limit) {
+        std::atomic_ref<double> dist(vertices.dist(v));
+        double old_distance = dist.load(std::memory_order_relaxed);
+        while (new_distance < old_distance) {
+            if (dist.compare_exchange_weak(old_distance, new_distance, std::memory_order_relaxed)) {
+                break;
+            }
+            ++task_counters[tid].write_min_retries;
+        }
+        if (!(new_distance < old_distance)) {
+            return false;
+        }
+        int new_bucket = bucket_of(new_distance);
+        if (old_distance == INF_MAX) {
+            touched[touched_counter.fetch_add(1)] = v;
+        }
+        if (new_bucket == current_generation) {
+            FusionQueue &queue = fusion_queues[tid];
+            if (queue.accepted < fusion_limit) {
+                queue.items.push_back(v);
+                ++queue.accepted;
+            }
+            else {
+                push_to_bucket(new_bucket, v, tid);
+            }
+        }
+        else if (old_distance == INF_MAX || bucket_of(old_distance) != new_bucket) {
+            push_to_bucket(new_bucket, v, tid);
+        }
+        return true;
+    }
+
+    // Two-level buckets: make the first block after the window with a vertex or parked request the new
+    // window. Coarse buckets are tried in block order, the overflow bucket once they are all empty.
+    // Returns false if there is no such block.
+    bool advance_window() {
+        for (uint64_t block = bucket_policy.window_block + 1; block < bucket_policy.overflow_block; ++block) {
+            if (occupied.test(BucketPolicy::coarse_bucket(block))) {
+                move_window(block);
+                return true;
+            }
+        }
+        const int overflow = BucketPolicy::OVERFLOW;
+        if (!occupied.test(overflow)) {
+            return false;
+        }
+        // the first block of the overflow bucket, skipping its stale entries
+        double first = INF_MAX;
+        for (size_t i = 0; i < buckets[overflow].size(); ++i) {
+            int v = buckets[overflow][i];
+            if (v >= 0 && bucket_of(vertices.dist(v)) == overflow) {
+                first = std::min(first, vertices.dist(v));
+            }
+        }
+        if (!parked.empty()) {
+            parked[overflow].for_each(0, parked[overflow].scan(), [&] (int v) {
+                first = std::min(first, vertices.request(v).load());
+            });
+        }
+        if (first == INF_MAX) {
+            clear_bucket(overflow);
+            if (!parked.empty()) {
+                parked[overflow].clear();
+            }
+            return false;
+        }
+        move_window(std::max(bucket_policy.block_of(first), bucket_policy.overflow_block));
+        return true;
+    }
+
+    // Two-level buckets: make block the window and move the vertices and parked requests of the bucket
+    // that held it (a coarse one, or the overflow bucket) to the buckets they map to now.
+    // Stale entries, whose vertex moved to another bucket meanwhile, are dropped.
+    void move_window(uint64_t block) {
+        int from = bucket_policy.bucket_of_block(block);
+        moved.clear();
+        for (size_t i = 0; i < buckets[from].size(); ++i) {
+            int v = buckets[from][i];
+            if (v >= 0 && bucket_of(vertices.dist(v)) == from) {
+                moved.push_back(v);
+            }
+        }
+        clear_bucket(from);
+        bucket_policy.set_window(block);
+        for (int v : moved) {
+            vertices.position(v) = push_to_bucket(bucket_of(vertices.dist(v)), v);
+        }
+        if (!parked.empty()) {
+            moved.clear();
+            parked[from].for_each(0, parked[from].scan(), [&] (int v) {
+                moved.push_back(v);
+            });
+            parked[from].clear();
+            for (int v : moved) {
+                double distance = vertices.request(v).load();
+                if (distance != INF_MAX) {
+                    int bucket = bucket_of(distance);
+                    parked[bucket].push(num_threads, v);
+                    occupied.set(bucket);
+                }
+            }
+        }
+    }
+
+    void close_block(BucketBlock &block) {
+        if (block.bucket != -1) {
+            for (size_t i = block.next; i < block.end; ++i) {
+                buckets[block.bucket][i] = -1;
+            }
+            block = BucketBlock();
+        }
+    }
+
+    // f(tid, first, last) for the vertex block of every pool worker, run by that worker
+    template<class F>
+    void for_each_block(size_t count, F &&f) {
+        if constexpr (requires (PoolType &p) { p.parallel_for_static(0, 0, f); }) {
+            pool.parallel_for_static(0, count, f);
+        }
+        else {
+            f(size_t(0), size_t(0), count);
+        }
+    }
+
+    size_t num_nodes() const {
+        if constexpr (requires (const PoolType &p) { p.num_nodes(); }) {
+            return pool.num_nodes();
+        }
+        else {
+            return 1;
+        }
+    }
+
+    // CSR arrays of a light / heavy copy, owned by the Graph that borrows them
+    struct SplitArrays {
+        FirstTouchArray<size_t> offsets;
+        FirstTouchArray<int> targets;
+        FirstTouchArray<double> weights;
+    };
+
+    // Copy of the light (or heavy) out-edges of every vertex. Each worker counts and then copies the rows
+    // of its own vertex block, so the rows are first touched by the worker that will scan them.
+    Graph split_edges(bool keep_light) {
+        int n = graph.size();
+        auto arrays = std::make_shared<SplitArrays>();
+        arrays->offsets = FirstTouchArray<size_t>(n + 1);
+        arrays->offsets.construct(0, 1, 0);
+        std::vector<size_t> block_start(num_threads + 1, 0);
+        for_each_block(n, [&] (size_t tid, size_t first, size_t last) {
+            size_t count = 0;
+            for (size_t u = first; u < last; ++u) {
+                for (const auto &[v, w] : graph[u]) {
+                    count += (w < delta) == keep_light;
+                }
+            }
+            block_start[tid + 1] = count;
+        });
+        for (size_t t = 0; t < num_threads; ++t) {
+            block_start[t + 1] += block_start[t];
+        }
+        size_t m = block_start[num_threads];
+        arrays->targets = FirstTouchArray<int>(m);
+        arrays->weights = FirstTouchArray<double>(m);
+        std::vector<double> block_max(num_threads, 0);
+        for_each_block(n, [&] (size_t tid, size_t first, size_t last) {
+            size_t pos = block_start[tid];
+            for (size_t u = first; u < last; ++u) {
+                for (const auto &[v, w] : graph[u]) {
+                    if ((w < delta) == keep_light) {
+                        arrays->targets.construct(pos, pos + 1, v);
+                        arrays->weights.construct(pos, pos + 1, w);
+                        block_max[tid] = std::max(block_max[tid], w);
+                        ++pos;
+                    }
+                }
+                arrays->offsets.construct(u + 1, u + 2, pos);
+            }
+        });
+        double max_weight = *std::max_element(block_max.begin(), block_max.end());
+        const size_t *offsets = arrays->offsets.data();
+        const int *targets = arrays->targets.data();
+        const double *weights = arrays->weights.data();
+        return Graph(n, m, offsets, targets, weights, max_weight, std::move(arrays), graph.neighbor_order());
+    }
+};
+
+// Lazily (re)binds a workspace to the graph a solver is asked about,
+// so repeated compute() calls on the same graph reuse it.
+template<class Workspace>
+class WorkspaceCache {
+public:
+    Workspace& get(const Graph &graph, double delta, size_t num_threads, bool split_by_weight = true) {
+        if (!workspace || !workspace->is_bound_to(graph)) {
+            workspace.reset();
+            workspace = std::make_unique<Workspace>(graph, delta, num_threads, split_by_weight);
+        }
+        return *workspace;
+    }
+
+    void release() {
+        workspace.reset();
+    }
+
+    std::vector<std::pair<std::string, uint64_t>> counters() const {
+        if (!workspace) {
+            return {};
+        }
+        return workspace->counters();
+    }
+
+private:
+    std::unique_ptr<Workspace> workspace;
+};
+
+#endif
@@ -14,6 +14,7 @@
 #include "pools/fast_pool.h"
 #include "lists/thread_safe_vector.h"
 #include "lists/circular_vector.h"
+#include "delta_stepping_workspace.h"
 
 class DSPRecycleBucket : public ShortestPathSolverBase {
 public:
@@ -21,155 +22,55 @@ public:
         return "Delta stepping - recycled buckets";
     }
 
-    using Request = Edge;
-
     DSPRecycleBucket(double delta, int num_threads): delta(delta), num_threads(num_threads) {}
 
-    std::vector<double> compute(const Graph &graph, int source) const override {
-        const double INF_MAX = std::numeric_limits<double>::infinity();
-        int n = graph.size();
-        std::vector<double> dist(n, INF_MAX);
-
-        std::vector<std::vector<AdjEdge>> heavy(n), light(n);
-        for (int u = 0; u < n; ++u) {
-            for (const auto &[v, w] : graph[u]) {
-                if (w < delta) {
-                    light[u].push_back({v, w});
-                }
-                else {
-                    heavy[u].push_back({v, w});
-                }
-            }
-        }
-
-        std::vector<int> position_in_bucket(n, -1);
-        
-        std::vector<ThreadSafeVector<int>> buckets(1);
-        
-        std::mutex buckets_resize_mutex;  // Add mutex for resize protection
-        buckets[0].push_back(source);
-        position_in_bucket[source] = 0;
-        dist[source] = 0;
-
-        std::vector<int> light_nodes_requested(n), heavy_nodes_requested(n);
-        std::atomic<size_t> light_nodes_counter{0}, heavy_nodes_counter{0};
-
-        std::vector<std::atomic<double>> light_request_map(n), heavy_request_map(n);
-
-        std::vector<int> updated_nodes(n);
-        std::atomic<size_t> updated_counter{0};
-
-        const int MAX_BUCKET_COUNT = (int)std::ceil(graph.get_max_edge_weight() / delta) + 5;
-        buckets.resize(MAX_BUCKET_COUNT);
+    using Workspace = DeltaSteppingWorkspace<ThreadSafeVector<int>, FastPool<moodycamel::BlockingConcurrentQueue>>;
 
-        int current_generation = 0;
-        
-        for (int i = 0; i < n; ++i) {
-            light_request_map[i].store(std::numeric_limits<double>::infinity());
-            heavy_request_map[i].store(std::numeric_limits<double>::infinity());
-        }
-
-        // positions is vector of atomic to node to Rl, Rh
-        // Rl, Rh are lock-free stack
-
-        auto get_bucket = [&] (int v) {
-            if (dist[v] == INF_MAX) {
-                return -1;
-            }
-            return int(dist[v] / delta) % MAX_BUCKET_COUNT;
-        };
-        
-        auto relax = [&] (int v, std::vector<std::atomic<double>> &requests) {
-            double new_distance = requests[v].exchange(std::numeric_limits<double>::infinity());
-
-            // note: during light edge relaxation, multiple readers - one writer can happen
-            // but that is fine, because the next epoch will take care of this concurrency issue
-            if (new_distance < dist[v]) {
-                int old_bucket = get_bucket(v);
-                dist[v] = new_distance;
-                int new_bucket = get_bucket(v);
-                
-                if (old_bucket != -1 && old_bucket != current_generation) {
-                    buckets[old_bucket][position_in_bucket[v]] = -1;
-                }
-                position_in_bucket[v] = buckets[new_bucket].push_back(v) - 1;
-            }
-        };
-
-        // Strictest request optimization -- No mutexes
-        auto add_request = [&] (std::vector<int> &requested_nodes, std::atomic<size_t> &idx_counter, std::vector<std::atomic<double>> &requests, const Request &request) {
-            std::atomic<double> &state = requests[request.v];
-            double new_distance = dist[request.u] + request.w;
-          
-            if (std::isinf(state.load())) {
-                double curr_state = state.load();
-                while (std::isinf(curr_state) && !state.compare_exchange_weak(curr_state, new_distance));
-                if (std::isinf(curr_state)) {
-                    size_t curr_idx = idx_counter.fetch_add(1);
-                    requested_nodes[curr_idx] = request.v;
-                }
-            }
+    std::vector<double> compute(const Graph &graph, int source) const override {
+        return solve(workspace_cache.get(graph, delta, num_threads), source);
+    }
 
-            double current_distance = state.load();
-            while (new_distance < current_distance && !state.compare_exchange_weak(current_distance, new_distance));
-        };
+    void release_workspace() const override {
+        workspace_cache.release();
+    }
 
-        auto gen_light_request = [&] (int u) {
-            for (const auto &[v, w] : light[u]) {
-                if (dist[u] + w < dist[v]) {
-                    add_request(light_nodes_requested, light_nodes_counter, light_request_map, Request{u, v, w});
-                }
-            }
-        };
+    std::vector<std::pair<std::string, uint64_t>> last_query_counters() const override {
+        return workspace_cache.counters();
+    }
 
-        auto gen_heavy_request = [&] (int u) {
-            for (const auto &[v, w] : heavy[u]) {
-                if (dist[u] + w < dist[v]) {
-                    add_request(heavy_nodes_requested, heavy_nodes_counter, heavy_request_map, Request{u, v, w});
-                }
-            }
-        };
+    // Run one query on a workspace bound to the graph; the result stays valid until the next query on it
+    std::vector<double> solve(Workspace &ws, int source) const {
+        ws.reset(source);
 
-        // bucket type is either linked list or vector
-        FastPool<moodycamel::BlockingConcurrentQueue> pool(num_threads);
+        const int workers = ws.num_threads;
+        std::vector<ThreadSafeVector<int>> &buckets = ws.buckets;
+        ThreadLocalLists<int> &light_requests = ws.light_requests, &heavy_requests = ws.heavy_requests;
+        int &current_generation = ws.current_generation;
+        auto &pool = ws.pool;
 
-        int generations_without_bucket = 0;
-        for (current_generation = 0; ; ++current_generation, ++generations_without_bucket) {
-            if (generations_without_bucket >= MAX_BUCKET_COUNT) {
-                break;
-            }
-            if (current_generation >= MAX_BUCKET_COUNT) {
-                current_generation = 0;
-            }
+        for (current_generation = 0; current_generation >= 0; current_generation = ws.next_bucket(current_generation)) {
             while (!buckets[current_generation].empty()) {
-                generations_without_bucket = 0;
 
                 {
                     // Loop 1: request generation
                     pool.start();
                     ThreadSafeVector<int> &curr_bucket = buckets[current_generation];
                     int curr_bucket_size = curr_bucket.size();
-                    int chunk_size = (curr_bucket_size + num_threads - 1) / num_threads;
-                    for (int idx = 0; idx < num_threads; ++idx) {
+                    int chunk_size = (curr_bucket_size + workers - 1) / workers;
+                    for (int idx = 0; idx < workers; ++idx) {
                         int start = idx * chunk_size;
                         int end = start + chunk_size;
                         if (end > curr_bucket_size) {
                             end = curr_bucket_size;
                         }
                         if (start < end) {
-                            pool.push([&, start, end] {
+                            // one task per chunk: both kinds of requests count in the task counters of idx
+                            pool.push([&, idx, start, end] {
                                 for (int idx_u = start; idx_u < end; ++idx_u) {
                                     int u = curr_bucket[idx_u];
                                     if (u >= 0) {
-                                        gen_light_request(u);
-                                    }
-                                }
-                            });
-                            pool.push([&, start, end] {
-                                for (int idx_u = start; idx_u < end; ++idx_u) {
-                                    int u = curr_bucket[idx_u];
-                                    if (u >= 0) {
-                                        gen_heavy_request(u);
+                                        ws.gen_light_request(u, idx);
+                                        ws.gen_heavy_request(u, idx);
                                     }
                                 }
                             });
@@ -177,7 +78,7 @@ public:
                     }
                     pool.reset(); // equivalent to join()
 
-                    curr_bucket.clear();
+                    ws.clear_bucket(current_generation);
                 }
 
 
@@ -185,34 +86,31 @@ public:
                 {
                     // std::cerr << "loop2\n";
                     pool.start();
-                    int requests_size = light_nodes_counter;
-                    int chunk_size = (requests_size + num_threads - 1) / num_threads;
-                    for (int idx = 0; idx < num_threads; ++idx) {
-                        int start = idx * chunk_size;
-                        int end = start + chunk_size;
-                        if (end > requests_size) {
-                            end = requests_size;
-                        }
+                    size_t requests_size = light_requests.scan();
+                    size_t chunk_size = (requests_size + workers - 1) / workers;
+                    for (int idx = 0; idx < workers; ++idx) {
+                        size_t start = std::min(requests_size, idx * chunk_size);
+                        size_t end = std::min(requests_size, start + chunk_size);
                         if (start < end) {
-                            pool.push([&, start, end] {
-                                for (int idx_r = start; idx_r < end; ++idx_r) {
-                                    int request_node = light_nodes_requested[idx_r];
-                                    relax(request_node, light_request_map);
-                                }
+                            pool.push([&, idx, start, end] {
+                                light_requests.for_each(start, end, [&] (int request_node) {
+                                    ws.relax(request_node, ws.light_requested, idx);
+                                });
+                                ws.flush_bucket_blocks(idx);
                             });
                         }
                     }
                     pool.reset();
 
-                    light_nodes_counter = 0;
+                    light_requests.clear();
                 }
 
                 // {
                 //     // Propagate updates to buckets
 
                 //     pool.start();
-                //     int chunk_size = (updated_counter + num_threads - 1) / num_threads;
-                //     for (int idx = 0; idx < num_threads; ++idx) {
+                //     int chunk_size = (updated_counter + workers - 1) / workers;
+                //     for (int idx = 0; idx < workers; ++idx) {
                 //         int start = idx * chunk_size;
                 //         int end = start + chunk_size;
                 //         if (end > (int)updated_counter) {
@@ -235,34 +133,31 @@ public:
             // Loop 3: relax heavy edges
             {
                 pool.start();
-                int requests_size = heavy_nodes_counter;
-                int chunk_size = (requests_size + num_threads - 1) / num_threads;
-                for (int idx = 0; idx < num_threads; ++idx) {
-                    int start = idx * chunk_size;
-                    int end = start + chunk_size;
-                    if (end > requests_size) {
-                        end = requests_size;
-                    }
+                size_t requests_size = heavy_requests.scan();
+                size_t chunk_size = (requests_size + workers - 1) / workers;
+                for (int idx = 0; idx < workers; ++idx) {
+                    size_t start = std::min(requests_size, idx * chunk_size);
+                    size_t end = std::min(requests_size, start + chunk_size);
                     if (start < end) {
-                        pool.push([&, start, end] {
-                            for (int idx_r = start; idx_r < end; ++idx_r) {
-                                int request_node = heavy_nodes_requested[idx_r];
-                                relax(request_node, heavy_request_map);
-                            }
+                        pool.push([&, idx, start, end] {
+                            heavy_requests.for_each(start, end, [&] (int request_node) {
+                                ws.relax(request_node, ws.heavy_requested, idx);
+                            });
+                            ws.flush_bucket_blocks(idx);
                         });
                     }
                 }
                 pool.reset();
 
-                heavy_nodes_counter = 0;
+                heavy_requests.clear();
             }
 
             // {
             //     // propagate updates to buckets
             //     pool.start();
                 
-            //     int chunk_size = (updated_counter + num_threads - 1) / num_threads;
-            //     for (int idx = 0; idx < num_threads; ++idx) {
+            //     int chunk_size = (updated_counter + workers - 1) / workers;
+            //     for (int idx = 0; idx < workers; ++idx) {
             //         int start = idx * chunk_size;
             //         int end = start + chunk_size;
             //         if (end > (int)updated_counter) {
@@ -282,13 +177,12 @@ public:
             // }
         }
 
-        pool.stop();
-
-        return dist;
+        return ws.distances();
     }
 private:
     double delta;
     int num_threads;
+    mutable WorkspaceCache<Workspace> workspace_cache;
 };
 
 #endif
\ No newline at end of file
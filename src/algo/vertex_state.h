@@ -0,0 +1,94 @@
+#ifndef VERTEX_STATE_H
+#define VERTEX_STATE_H
+
+#include <cstddef>
+#include "lists/first_touch_array.h"
+#include "atomics/atomic_min_double.h"
+
+// Per-vertex state of the parallel delta-stepping workspace: the tentative distance, the smallest
+// pending request and the position of the vertex in its bucket. Two layouts with the same interface,
+// chosen by the VertexState parameter of DeltaSteppingWorkspace:
+//  SplitVertexState   one array per field (structure of arrays)
+//  PackedVertexState  one 32-byte record per vertex, so relaxing v touches a single cache line
+// construct() initializes the vertices [first, last) and is called by the worker owning them.
+
+class SplitVertexState {
+public:
+    explicit SplitVertexState(size_t count): distances(count), positions(count), requests(count) {}
+
+    void construct(size_t first, size_t last, double distance, int position) {
+        distances.construct(first, last, distance);
+        positions.construct(first, last, position);
+        requests.construct(first, last);
+    }
+
+    double &dist(size_t v) {
+        return distances[v];
+    }
+
+    const double &dist(size_t v) const {
+        return distances[v];
+    }
+
+    int &position(size_t v) {
+        return positions[v];
+    }
+
+    AtomicMinDouble &request(size_t v) {
+        return requests[v];
+    }
+
+    static const char *name() {
+        return "split";
+    }
+
+private:
+    FirstTouchArray<double> distances;
+    FirstTouchArray<int> positions;
+    FirstTouchArray<AtomicMinDouble> requests;
+};
+
+class PackedVertexState {
+public:
+    explicit PackedVertexState(size_t count): records(count) {}
+
+    void construct(size_t first, size_t last, double distance, int position) {
+        records.construct(first, last, distance, position);
+    }
+
+    double &dist(size_t v) {
+        return records[v].distance;
+    }
+
+    const double &dist(size_t v) const {
+        return records[v].distance;
+    }
+
+    int &position(size_t v) {
+        return records[v].position;
+    }
+
+    AtomicMinDouble &request(size_t v) {
+        return records[v].request;
+    }
+
+    static const char *name() {
+        return "packed";
+    }
+
+private:
+    // two records per cache line, none straddles a line
+    struct alignas(32) Record {
+        Record(double distance, int position): distance(distance), position(position) {}
+
+        AtomicMinDouble request;
+        double distance;
+        int position;
+    };
+
+    static_assert(sizeof(Record) == 32, "a vertex record is meant to be half a cache line");
+
+    FirstTouchArray<Record> records;
+};
+
+#endif
@@ -2,6 +2,14 @@
 #define GRAPH_H
 
 #include <vector>
+#include <cstddef>
+#include <iterator>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include "parallel_utils.h"
+#include "huge_pages.h"
 
 using AdjEdge = std::pair<int, double>;
 
@@ -10,32 +18,412 @@ struct Edge {
     double w;
 };
 
+// Read-only view over the out-edges of one vertex.
+// Targets and weights live in separate contiguous arrays (structure of arrays),
+// an edge is materialized as an AdjEdge only when dereferenced.
+class AdjacencyRange {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = AdjEdge;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = AdjEdge;
+
+        iterator() = default;
+        iterator(const int *target, const double *weight): target(target), weight(weight) {}
+
+        AdjEdge operator*() const {
+            return {*target, *weight};
+        }
+
+        AdjEdge operator[](difference_type k) const {
+            return {target[k], weight[k]};
+        }
+
+        iterator& operator++() {
+            ++target;
+            ++weight;
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        iterator& operator--() {
+            --target;
+            --weight;
+            return *this;
+        }
+
+        iterator operator--(int) {
+            iterator old = *this;
+            --*this;
+            return old;
+        }
+
+        iterator& operator+=(difference_type k) {
+            target += k;
+            weight += k;
+            return *this;
+        }
+
+        iterator& operator-=(difference_type k) {
+            return *this += -k;
+        }
+
+        friend iterator operator+(iterator it, difference_type k) {
+            return it += k;
+        }
+
+        friend iterator operator+(difference_type k, iterator it) {
+            return it += k;
+        }
+
+        friend iterator operator-(iterator it, difference_type k) {
+            return it -= k;
+        }
+
+        friend difference_type operator-(const iterator &a, const iterator &b) {
+            return a.target - b.target;
+        }
+
+        friend bool operator==(const iterator &a, const iterator &b) {
+            return a.target == b.target;
+        }
+
+        friend auto operator<=>(const iterator &a, const iterator &b) {
+            return a.target <=> b.target;
+        }
+
+    private:
+        const int *target = nullptr;
+        const double *weight = nullptr;
+    };
+
+    AdjacencyRange(const int *targets, const double *weights, size_t count):
+        target_data(targets), weight_data(weights), count(count) {}
+
+    iterator begin() const {
+        return iterator(target_data, weight_data);
+    }
+
+    iterator end() const {
+        return iterator(target_data + count, weight_data + count);
+    }
+
+    AdjEdge operator[](size_t k) const {
+        return {target_data[k], weight_data[k]};
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    const int* targets() const {
+        return target_data;
+    }
+
+    const double* weights() const {
+        return weight_data;
+    }
+
+private:
+    const int *target_data;
+    const double *weight_data;
+    size_t count;
+};
+
+// Order of the out-edges of a vertex when a graph is built from an edge list
+enum class NeighborOrder {
+    INPUT,      // order of the input list (no particular order for adopted or borrowed arrays)
+    BY_TARGET,  // sorted by target, then weight
+    BY_WEIGHT   // sorted by weight, then target: for any delta the light edges are a prefix of the row
+};
+
 // nodes are 0-indexed
+// Adjacency is stored in compressed sparse row form: the out-edges of u are
+// targets[offsets[u] .. offsets[u + 1]) with matching entries in weights.
+// Edges of a vertex keep the order in which they appear in the input list, unless NeighborOrder says otherwise.
+// A graph sorted BY_WEIGHT lets delta-stepping split every row into light / heavy edges with a binary search.
+// The arrays are either owned by the graph or borrowed from external memory (e.g. a mapped file)
+// that a keepalive handle holds on to; copies share the same immutable arrays.
 class Graph {
 public:
-    Graph(int n, const std::vector<Edge> &edges) : n(n) {
-        adj.resize(n);
-        for (const auto &[u, v, w] : edges) {
-            adj[u].push_back({v, w});
-            max_L = std::max(max_L, w);
-        }
+    Graph(int n, const std::vector<Edge> &edges, NeighborOrder order = NeighborOrder::INPUT, size_t num_threads = default_thread_count()) :
+        n(n), order(order), graph_id(next_id()) {
+        build_from_edges(edges, order, num_threads);
+    }
+
+    // Adopt already built CSR arrays (offsets has n + 1 entries) whose rows are already in the given order.
+    // Arrays from std::vector keep the heap pages they were allocated on, HugePageVector arrays their huge pages.
+    Graph(int n, std::vector<size_t> &&offsets, std::vector<int> &&targets, std::vector<double> &&weights, NeighborOrder order = NeighborOrder::INPUT) :
+        n(n), order(order), graph_id(next_id()) {
+        adopt_arrays(std::move(offsets), std::move(targets), std::move(weights));
+    }
+
+    Graph(int n, HugePageVector<size_t> &&offsets, HugePageVector<int> &&targets, HugePageVector<double> &&weights, NeighborOrder order = NeighborOrder::INPUT) :
+        n(n), order(order), graph_id(next_id()) {
+        adopt_arrays(std::move(offsets), std::move(targets), std::move(weights));
+    }
+
+    // Borrow CSR arrays that live elsewhere; keepalive owns that memory for as long as any copy of the graph exists
+    Graph(int n, size_t m, const size_t *offsets, const int *targets, const double *weights, double max_weight, std::shared_ptr<const void> keepalive,
+          NeighborOrder order = NeighborOrder::INPUT) :
+        n(n), m(m), offsets(offsets), targets(targets), weights(weights), storage(std::move(keepalive)), max_L(max_weight), order(order), graph_id(next_id()) {
+        max_deg = scan_max_degree();
     }
 
     double get_max_edge_weight() const {
         return max_L;
     }
 
-    const std::vector<AdjEdge>& operator[](int idx) const {
-        return adj[idx];
+    AdjacencyRange operator[](int idx) const {
+        size_t begin = offsets[idx];
+        return AdjacencyRange(targets + begin, weights + begin, offsets[idx + 1] - begin);
+    }
+
+    size_t degree(int idx) const {
+        return offsets[idx + 1] - offsets[idx];
+    }
+
+    NeighborOrder neighbor_order() const {
+        return order;
+    }
+
+    // Number of out-edges of idx lighter than delta, found by binary search.
+    // Only meaningful for a graph sorted BY_WEIGHT, where they are the first edges of the row.
+    size_t light_degree(int idx, double delta) const {
+        const double *first = weights + offsets[idx];
+        const double *last = weights + offsets[idx + 1];
+        return std::lower_bound(first, last, delta) - first;
+    }
+
+    // Copy of the graph with every row put in the given order
+    Graph with_neighbor_order(NeighborOrder new_order, size_t num_threads = default_thread_count()) const {
+        auto owned = std::make_shared<Storage>();
+        owned->offsets.assign(offsets, offsets + n + 1);
+        owned->targets.assign(targets, targets + m);
+        owned->weights.assign(weights, weights + m);
+        sort_rows(*owned, new_order, num_threads);
+        return Graph(n, std::move(owned->offsets), std::move(owned->targets), std::move(owned->weights), new_order);
+    }
+
+    size_t max_degree() const {
+        return max_deg;
     }
 
     int size() const {
         return n;
     }
+
+    size_t num_edges() const {
+        return m;
+    }
+
+    // Unique per constructed graph, lets cached solver state detect that it was built for another graph
+    uint64_t id() const {
+        return graph_id;
+    }
+
+    // raw CSR arrays, for hot loops that want to index edges directly
+    const size_t* offset_data() const {
+        return offsets;
+    }
+
+    const int* target_data() const {
+        return targets;
+    }
+
+    const double* weight_data() const {
+        return weights;
+    }
+
+    // backing of the edge arrays (see huge_pages.h), 4 KB pages for mapped files
+    PageBacking page_backing() const {
+        return ::page_backing(targets);
+    }
 private:
+    template<class Offsets, class Targets, class Weights>
+    struct Arrays {
+        Offsets offsets;
+        Targets targets;
+        Weights weights;
+    };
+
+    // arrays the graph builds itself live on huge pages when available
+    using Storage = Arrays<HugePageVector<size_t>, HugePageVector<int>, HugePageVector<double>>;
+
     int n;
-    std::vector<std::vector<AdjEdge>> adj;
+    size_t m = 0;
+    const size_t *offsets = nullptr;
+    const int *targets = nullptr;
+    const double *weights = nullptr;
+    std::shared_ptr<const void> storage;
     double max_L = 0.;
+    size_t max_deg = 0;
+    NeighborOrder order = NeighborOrder::INPUT;
+    uint64_t graph_id;
+
+    template<class S>
+    void adopt(std::shared_ptr<S> owned) {
+        m = owned->targets.size();
+        offsets = owned->offsets.data();
+        targets = owned->targets.data();
+        weights = owned->weights.data();
+        storage = std::move(owned);
+    }
+
+    template<class Offsets, class Targets, class Weights>
+    void adopt_arrays(Offsets &&offsets, Targets &&targets, Weights &&weights) {
+        auto owned = std::make_shared<Arrays<Offsets, Targets, Weights>>();
+        owned->offsets = std::move(offsets);
+        owned->targets = std::move(targets);
+        owned->weights = std::move(weights);
+        for (double w : owned->weights) {
+            max_L = std::max(max_L, w);
+        }
+        adopt(std::move(owned));
+        max_deg = scan_max_degree();
+    }
+
+    // Parallel CSR construction. Edges are cut into one contiguous block per thread:
+    //  1. every thread counts the out-degree of each vertex within its block (and the block's max weight),
+    //  2. a prefix sum over (vertex, block) turns the counts into the row offsets and per-block write cursors,
+    //     finding the max degree on the way,
+    //  3. every thread scatters its block through its cursors.
+    // Blocks land in input order within each row, so the result does not depend on the thread count;
+    // rows are sorted afterwards if another NeighborOrder is asked for.
+    // The counts take num_threads * n words, which is why the thread count is capped by the average degree.
+    // The arrays are value-initialized on the calling thread and filled by unpinned threads, so they are not
+    // placed per NUMA node; a workspace whose pool spans several nodes scans its own per-block copies instead.
+    void build_from_edges(const std::vector<Edge> &edges, NeighborOrder order, size_t num_threads) {
+        const size_t min_edges_per_thread = 1 << 16;
+        size_t total = edges.size();
+        size_t rows = n;
+        num_threads = std::max<size_t>(1, std::min({num_threads, total / min_edges_per_thread, total / (rows + 1)}));
+
+        auto owned = std::make_shared<Storage>();
+        owned->offsets.resize(rows + 1);
+        owned->targets.resize(total);
+        owned->weights.resize(total);
+        std::unique_ptr<size_t[]> counts(new size_t[num_threads * rows]);
+        std::vector<double> block_max_weight(num_threads, 0.);
+        std::vector<size_t> block_edges(num_threads + 1, 0), block_max_degree(num_threads, 0);
+
+        run_on_threads(num_threads, [&] (size_t tid) {
+            size_t *count = counts.get() + tid * rows;
+            std::fill(count, count + rows, 0);
+            auto [begin, end] = block_range(total, num_threads, tid);
+            double max_weight = 0.;
+            for (size_t i = begin; i < end; ++i) {
+                ++count[edges[i].u];
+                max_weight = std::max(max_weight, edges[i].w);
+            }
+            block_max_weight[tid] = max_weight;
+        });
+
+        // the scan runs over vertex blocks: sum each block, scan the sums, then fill in every block
+        run_on_threads(num_threads, [&] (size_t tid) {
+            auto [begin, end] = block_range(rows, num_threads, tid);
+            size_t sum = 0, max_degree = 0;
+            for (size_t u = begin; u < end; ++u) {
+                size_t degree = 0;
+                for (size_t t = 0; t < num_threads; ++t) {
+                    degree += counts[t * rows + u];
+                }
+                sum += degree;
+                max_degree = std::max(max_degree, degree);
+            }
+            block_edges[tid + 1] = sum;
+            block_max_degree[tid] = max_degree;
+        });
+        for (size_t tid = 0; tid < num_threads; ++tid) {
+            block_edges[tid + 1] += block_edges[tid];
+        }
+        run_on_threads(num_threads, [&] (size_t tid) {
+            auto [begin, end] = block_range(rows, num_threads, tid);
+            size_t running = block_edges[tid];
+            for (size_t u = begin; u < end; ++u) {
+                owned->offsets[u] = running;
+                for (size_t t = 0; t < num_threads; ++t) {
+                    size_t count = counts[t * rows + u];
+                    counts[t * rows + u] = running;
+                    running += count;
+                }
+            }
+        });
+        owned->offsets[rows] = total;
+
+        run_on_threads(num_threads, [&] (size_t tid) {
+            size_t *cursor = counts.get() + tid * rows;
+            auto [begin, end] = block_range(total, num_threads, tid);
+            for (size_t i = begin; i < end; ++i) {
+                size_t pos = cursor[edges[i].u]++;
+                owned->targets[pos] = edges[i].v;
+                owned->weights[pos] = edges[i].w;
+            }
+        });
+
+        sort_rows(*owned, order, num_threads);
+
+        max_L = *std::max_element(block_max_weight.begin(), block_max_weight.end());
+        max_deg = *std::max_element(block_max_degree.begin(), block_max_degree.end());
+        adopt(std::move(owned));
+    }
+
+    // Sort every row of the arrays in parallel (row blocks per thread), INPUT leaves them as they are
+    static void sort_rows(Storage &arrays, NeighborOrder order, size_t num_threads) {
+        if (order == NeighborOrder::INPUT) {
+            return;
+        }
+        size_t rows = arrays.offsets.size() - 1;
+        num_threads = std::max<size_t>(1, std::min(num_threads, arrays.targets.size() / (1 << 16)));
+        run_on_threads(num_threads, [&] (size_t tid) {
+            auto [begin, end] = block_range(rows, num_threads, tid);
+            std::vector<AdjEdge> row;
+            for (size_t u = begin; u < end; ++u) {
+                size_t first = arrays.offsets[u], last = arrays.offsets[u + 1];
+                row.clear();
+                for (size_t k = first; k < last; ++k) {
+                    row.emplace_back(arrays.targets[k], arrays.weights[k]);
+                }
+                if (order == NeighborOrder::BY_TARGET) {
+                    std::sort(row.begin(), row.end());
+                }
+                else {
+                    std::sort(row.begin(), row.end(), [] (const AdjEdge &a, const AdjEdge &b) {
+                        return a.second < b.second || (a.second == b.second && a.first < b.first);
+                    });
+                }
+                for (size_t k = first; k < last; ++k) {
+                    arrays.targets[k] = row[k - first].first;
+                    arrays.weights[k] = row[k - first].second;
+                }
+            }
+        });
+    }
+
+    size_t scan_max_degree() const {
+        size_t result = 0;
+        for (int u = 0; u < n; ++u) {
+            result = std::max(result, degree(u));
+        }
+        return result;
+    }
+
+    static uint64_t next_id() {
+        static std::atomic<uint64_t> counter{0};
+        return ++counter;
+    }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,229 @@
+#ifndef GRAPH_BINARY_H
+#define GRAPH_BINARY_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "graph.h"
+
+// Binary CSR graph file, version 1 (little-endian):
+//   BinaryGraphHeader
+//   offsets: uint64[num_vertices + 1]   at offsets_pos
+//   targets: int32[num_edges]           at targets_pos
+//   weights: float64[num_edges]         at weights_pos
+// Every section starts on a BINARY_GRAPH_ALIGNMENT boundary, so a mapped file can be used in place.
+// flags records the NeighborOrder of the rows (see BINARY_GRAPH_FLAG_*), other bits must be zero.
+constexpr char BINARY_GRAPH_MAGIC[8] = {'D', 'S', 'G', 'R', 'A', 'P', 'H', '\0'};
+constexpr uint32_t BINARY_GRAPH_VERSION = 1;
+constexpr uint32_t BINARY_GRAPH_BYTE_ORDER = 0x01020304;
+constexpr uint64_t BINARY_GRAPH_ALIGNMENT = 64;
+constexpr uint64_t BINARY_GRAPH_FLAG_SORTED_BY_TARGET = 1 << 0;
+constexpr uint64_t BINARY_GRAPH_FLAG_SORTED_BY_WEIGHT = 1 << 1;
+constexpr uint64_t BINARY_GRAPH_KNOWN_FLAGS = BINARY_GRAPH_FLAG_SORTED_BY_TARGET | BINARY_GRAPH_FLAG_SORTED_BY_WEIGHT;
+
+struct BinaryGraphHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t flags;
+    uint64_t num_vertices;
+    uint64_t num_edges;
+    double max_weight;
+    uint64_t offsets_pos;
+    uint64_t targets_pos;
+    uint64_t weights_pos;
+    uint64_t file_size;
+};
+
+static_assert(sizeof(size_t) == sizeof(uint64_t), "binary graph offsets are mapped as size_t");
+
+inline uint64_t binary_graph_align(uint64_t pos) {
+    return (pos + BINARY_GRAPH_ALIGNMENT - 1) / BINARY_GRAPH_ALIGNMENT * BINARY_GRAPH_ALIGNMENT;
+}
+
+// section positions follow from the vertex and edge counts alone
+inline void set_binary_graph_layout(BinaryGraphHeader &header) {
+    header.offsets_pos = binary_graph_align(sizeof(BinaryGraphHeader));
+    header.targets_pos = binary_graph_align(header.offsets_pos + (header.num_vertices + 1) * sizeof(uint64_t));
+    header.weights_pos = binary_graph_align(header.targets_pos + header.num_edges * sizeof(int32_t));
+    header.file_size = header.weights_pos + header.num_edges * sizeof(double);
+}
+
+inline BinaryGraphHeader make_binary_graph_header(const Graph &graph) {
+    BinaryGraphHeader header{};
+    std::memcpy(header.magic, BINARY_GRAPH_MAGIC, sizeof(header.magic));
+    header.version = BINARY_GRAPH_VERSION;
+    header.byte_order = BINARY_GRAPH_BYTE_ORDER;
+    header.flags = graph.neighbor_order() == NeighborOrder::BY_TARGET ? BINARY_GRAPH_FLAG_SORTED_BY_TARGET
+                 : graph.neighbor_order() == NeighborOrder::BY_WEIGHT ? BINARY_GRAPH_FLAG_SORTED_BY_WEIGHT : 0;
+    header.num_vertices = graph.size();
+    header.num_edges = graph.num_edges();
+    header.max_weight = graph.get_max_edge_weight();
+    set_binary_graph_layout(header);
+    return header;
+}
+
+// true if the file starts with the binary graph magic
+inline bool is_binary_graph_file(const std::string &filename) {
+    std::ifstream in(filename, std::ios::binary);
+    char magic[sizeof(BINARY_GRAPH_MAGIC)] = {};
+    in.read(magic, sizeof(magic));
+    return in.gcount() == (std::streamsize)sizeof(magic) && std::memcmp(magic, BINARY_GRAPH_MAGIC, sizeof(magic)) == 0;
+}
+
+inline bool save_graph_to_binary_file(const Graph &graph, const std::string &filename) {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open file " << filename << " for writing." << std::endl;
+        return false;
+    }
+
+    BinaryGraphHeader header = make_binary_graph_header(graph);
+    auto pad_to = [&] (uint64_t pos) {
+        static const char zeros[BINARY_GRAPH_ALIGNMENT] = {};
+        uint64_t current = out.tellp();
+        out.write(zeros, pos - current);
+    };
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    pad_to(header.offsets_pos);
+    out.write(reinterpret_cast<const char*>(graph.offset_data()), (header.num_vertices + 1) * sizeof(uint64_t));
+    pad_to(header.targets_pos);
+    out.write(reinterpret_cast<const char*>(graph.target_data()), header.num_edges * sizeof(int32_t));
+    pad_to(header.weights_pos);
+    out.write(reinterpret_cast<const char*>(graph.weight_data()), header.num_edges * sizeof(double));
+    out.close();
+
+    if (!out) {
+        std::cerr << "Error: Failed writing binary graph " << filename << std::endl;
+        return false;
+    }
+    std::cout << "Graph saved to: " << filename << " (" << header.num_vertices << " vertices, " << header.num_edges << " edges, binary CSR)" << std::endl;
+    return true;
+}
+
+// Memory-map a binary graph file read-only and expose it as a Graph without copying.
+// The mapping is shared, so processes loading the same file share its page-cached copy.
+// Returns an empty graph (and reports why) if the file is missing or malformed.
+inline Graph map_graph_from_binary_file(const std::string &filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error: Could not open file " << filename << std::endl;
+        return Graph(0, {});
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(BinaryGraphHeader)) {
+        std::cerr << "Error: " << filename << " is too small to be a binary graph" << std::endl;
+        close(fd);
+        return Graph(0, {});
+    }
+
+    size_t length = st.st_size;
+    void *base = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        std::cerr << "Error: Could not map file " << filename << std::endl;
+        return Graph(0, {});
+    }
+    std::shared_ptr<const void> mapping(base, [length] (const void *p) {
+        munmap(const_cast<void*>(p), length);
+    });
+
+    BinaryGraphHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    const char *error = nullptr;
+    if (std::memcmp(header.magic, BINARY_GRAPH_MAGIC, sizeof(header.magic)) != 0) {
+        error = "bad magic";
+    }
+    else if (header.version != BINARY_GRAPH_VERSION) {
+        error = "unsupported format version";
+    }
+    else if (header.byte_order != BINARY_GRAPH_BYTE_ORDER) {
+        error = "byte order differs from this machine";
+    }
+    else if ((header.flags & ~BINARY_GRAPH_KNOWN_FLAGS) != 0 || header.flags == BINARY_GRAPH_KNOWN_FLAGS) {
+        error = "unknown flags";
+    }
+    else if (header.num_vertices > (uint64_t)std::numeric_limits<int>::max() || header.num_edges > (uint64_t)std::numeric_limits<int64_t>::max() / sizeof(double)) {
+        error = "too many vertices or edges";
+    }
+    else {
+        BinaryGraphHeader expected = header;
+        set_binary_graph_layout(expected);
+        if (header.offsets_pos != expected.offsets_pos || header.targets_pos != expected.targets_pos ||
+            header.weights_pos != expected.weights_pos || header.file_size != expected.file_size) {
+            error = "corrupt section layout";
+        }
+        else if (header.file_size != length) {
+            error = "file size does not match header";
+        }
+    }
+    if (error != nullptr) {
+        std::cerr << "Error: " << filename << " is not a valid binary graph (" << error << ")" << std::endl;
+        return Graph(0, {});
+    }
+
+    const char *bytes = static_cast<const char*>(base);
+    const size_t *offsets = reinterpret_cast<const size_t*>(bytes + header.offsets_pos);
+    const int *targets = reinterpret_cast<const int*>(bytes + header.targets_pos);
+    const double *weights = reinterpret_cast<const double*>(bytes + header.weights_pos);
+    // one pass over the mapped arrays: the solvers index with them unchecked, and the bucket count
+    // follows from the maximum weight, so neither is taken from the file on trust
+    const int n = (int)header.num_vertices;
+    double max_weight = 0.;
+    if (offsets[0] != 0 || offsets[n] != header.num_edges) {
+        error = "inconsistent offsets";
+    }
+    for (int u = 0; error == nullptr && u < n; ++u) {
+        if (offsets[u + 1] < offsets[u]) {
+            error = "decreasing offsets";
+        }
+    }
+    // the recorded row order is checked as well: light_degree() splits a BY_WEIGHT row by binary search
+    const bool by_target = header.flags & BINARY_GRAPH_FLAG_SORTED_BY_TARGET;
+    const bool by_weight = header.flags & BINARY_GRAPH_FLAG_SORTED_BY_WEIGHT;
+    bool rows_sorted = true;
+    for (int u = 0; error == nullptr && u < n; ++u) {
+        for (size_t e = offsets[u]; error == nullptr && e < offsets[u + 1]; ++e) {
+            if (targets[e] < 0 || targets[e] >= n) {
+                error = "edge target out of range";
+            }
+            else if (!(weights[e] >= 0.) || std::isinf(weights[e])) {
+                error = "negative or non-finite edge weight";
+            }
+            else {
+                max_weight = std::max(max_weight, weights[e]);
+            }
+            if (e > offsets[u] && ((by_target && targets[e] < targets[e - 1]) || (by_weight && weights[e] < weights[e - 1]))) {
+                rows_sorted = false;
+            }
+        }
+    }
+    if (error != nullptr) {
+        std::cerr << "Error: " << filename << " is not a valid binary graph (" << error << ")" << std::endl;
+        return Graph(0, {});
+    }
+    if (header.max_weight != max_weight) {
+        std::cerr << "Warning: " << filename << " records maximum weight " << header.max_weight << ", using the actual " << max_weight << std::endl;
+    }
+    if (!rows_sorted) {
+        std::cerr << "Warning: " << filename << " records sorted rows but they are not, mapping them in input order" << std::endl;
+    }
+
+    NeighborOrder order = !rows_sorted ? NeighborOrder::INPUT
+                        : by_target ? NeighborOrder::BY_TARGET : by_weight ? NeighborOrder::BY_WEIGHT : NeighborOrder::INPUT;
+    std::cout << "Mapped graph from " << filename << ": " << header.num_vertices << " vertices, " << header.num_edges << " edges" << std::endl;
+    return Graph(n, header.num_edges, offsets, targets, weights, max_weight, std::move(mapping), order);
+}
+
+#endif
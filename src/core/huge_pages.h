@@ -0,0 +1,215 @@
+#ifndef HUGE_PAGES_H
+#define HUGE_PAGES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+#include <sys/mman.h>
+
+// Page backing of large arrays (graph CSR, vertex arrays, buckets).
+// Arrays of at least HUGE_PAGE_SIZE bytes are mapped anonymously on a 2 MB boundary and, depending on
+// the process-wide HugePageMode, either marked MADV_HUGEPAGE (transparent huge pages) or mapped from the
+// hugetlbfs pool (MAP_HUGETLB). Every step falls back to the next one: hugetlb -> THP -> 4 KB pages.
+// Smaller arrays come from the heap. page_backing() tells which backing a large array got.
+
+constexpr size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+enum class HugePageMode { OFF, TRANSPARENT, HUGETLB };
+enum class PageBacking { SMALL_PAGES, TRANSPARENT_HUGE_PAGES, HUGETLB_PAGES };
+
+// mode used by allocations from now on, set it before graphs and solvers are created
+inline HugePageMode &default_huge_page_mode() {
+    static HugePageMode mode = HugePageMode::TRANSPARENT;
+    return mode;
+}
+
+// "off", "thp" or "hugetlb"
+inline bool parse_huge_page_mode(const std::string &text, HugePageMode &mode) {
+    if (text == "off") {
+        mode = HugePageMode::OFF;
+    }
+    else if (text == "thp") {
+        mode = HugePageMode::TRANSPARENT;
+    }
+    else if (text == "hugetlb") {
+        mode = HugePageMode::HUGETLB;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+inline const char *page_backing_name(PageBacking backing) {
+    switch (backing) {
+    case PageBacking::TRANSPARENT_HUGE_PAGES:
+        return "transparent huge pages";
+    case PageBacking::HUGETLB_PAGES:
+        return "hugetlbfs pages";
+    default:
+        return "4 KB pages";
+    }
+}
+
+namespace huge_pages_detail {
+
+struct Region {
+    size_t bytes;
+    PageBacking backing;
+};
+
+// live mappings by start address; only large arrays are registered, so the lock is rarely taken
+struct Registry {
+    std::mutex lock;
+    std::map<uintptr_t, Region> regions;
+};
+
+inline Registry &registry() {
+    static Registry instance;
+    return instance;
+}
+
+inline size_t mapped_size(size_t bytes) {
+    return (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+}
+
+// madvise(MADV_HUGEPAGE) succeeds even when THP is switched off, so ask the kernel setting
+inline bool transparent_huge_pages_enabled() {
+    static const bool enabled = [] {
+        std::ifstream in("/sys/kernel/mm/transparent_hugepage/enabled");
+        std::string setting;
+        std::getline(in, setting);
+        return !setting.empty() && setting.find("[never]") == std::string::npos;
+    }();
+    return enabled;
+}
+
+// anonymous mapping of size bytes starting on a 2 MB boundary (the slack around it is unmapped again)
+inline void *map_aligned(size_t size) {
+    void *raw = mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        return nullptr;
+    }
+    uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    if (aligned > start) {
+        munmap(raw, aligned - start);
+    }
+    size_t tail = start + size + HUGE_PAGE_SIZE - (aligned + size);
+    if (tail > 0) {
+        munmap(reinterpret_cast<void*>(aligned + size), tail);
+    }
+    return reinterpret_cast<void*>(aligned);
+}
+
+} // namespace huge_pages_detail
+
+// Memory for bytes bytes, aligned to at least 64 bytes, never initialized. Release with free_pages(p, bytes).
+inline void *allocate_pages(size_t bytes) {
+    using namespace huge_pages_detail;
+    if (bytes < HUGE_PAGE_SIZE) {
+        return ::operator new(bytes == 0 ? 1 : bytes, std::align_val_t(64));
+    }
+    size_t size = mapped_size(bytes);
+    HugePageMode mode = default_huge_page_mode();
+    void *p = nullptr;
+    PageBacking backing = PageBacking::SMALL_PAGES;
+    if (mode == HugePageMode::HUGETLB) {
+        p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p == MAP_FAILED) {
+            p = nullptr; // no reserved huge pages left, fall back to THP
+        }
+        else {
+            backing = PageBacking::HUGETLB_PAGES;
+        }
+    }
+    if (p == nullptr) {
+        p = map_aligned(size);
+        if (p == nullptr) {
+            throw std::bad_alloc();
+        }
+        if (mode != HugePageMode::OFF && transparent_huge_pages_enabled() && madvise(p, size, MADV_HUGEPAGE) == 0) {
+            backing = PageBacking::TRANSPARENT_HUGE_PAGES;
+        }
+    }
+    std::lock_guard<std::mutex> guard(registry().lock);
+    registry().regions[reinterpret_cast<uintptr_t>(p)] = Region{size, backing};
+    return p;
+}
+
+inline void free_pages(void *p, size_t bytes) {
+    using namespace huge_pages_detail;
+    if (p == nullptr) {
+        return;
+    }
+    if (bytes < HUGE_PAGE_SIZE) {
+        ::operator delete(p, std::align_val_t(64));
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(registry().lock);
+        registry().regions.erase(reinterpret_cast<uintptr_t>(p));
+    }
+    munmap(p, mapped_size(bytes));
+}
+
+// Backing of the array starting at p, 4 KB pages for heap arrays and memory not allocated here
+inline PageBacking page_backing(const void *p) {
+    using namespace huge_pages_detail;
+    std::lock_guard<std::mutex> guard(registry().lock);
+    auto it = registry().regions.find(reinterpret_cast<uintptr_t>(p));
+    return it == registry().regions.end() ? PageBacking::SMALL_PAGES : it->second.backing;
+}
+
+// MB currently mapped per backing, e.g. "1024 MB transparent huge pages, 6 MB 4 KB pages"
+inline std::string page_backing_summary() {
+    using namespace huge_pages_detail;
+    size_t bytes[3] = {0, 0, 0};
+    {
+        std::lock_guard<std::mutex> guard(registry().lock);
+        for (const auto &[start, region] : registry().regions) {
+            bytes[(int)region.backing] += region.bytes;
+        }
+    }
+    std::string result;
+    for (int b = 2; b >= 0; --b) {
+        if (bytes[b] > 0) {
+            result += (result.empty() ? "" : ", ") + std::to_string(bytes[b] >> 20) + " MB " + page_backing_name(PageBacking(b));
+        }
+    }
+    return result.empty() ? "no large arrays" : result;
+}
+
+// std::allocator replacement that routes allocations through allocate_pages()
+template<class T>
+struct HugePageAllocator {
+    using value_type = T;
+
+    HugePageAllocator() = default;
+
+    template<class U>
+    HugePageAllocator(const HugePageAllocator<U>&) {}
+
+    T *allocate(size_t count) {
+        return static_cast<T*>(allocate_pages(count * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t count) {
+        free_pages(p, count * sizeof(T));
+    }
+
+    template<class U>
+    bool operator==(const HugePageAllocator<U>&) const {
+        return true;
+    }
+};
+
+template<class T>
+using HugePageVector = std::vector<T, HugePageAllocator<T>>;
+
+#endif
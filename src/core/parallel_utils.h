@@ -0,0 +1,89 @@
+#ifndef PARALLEL_UTILS_H
+#define PARALLEL_UTILS_H
+
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+
+// Helpers for the one-shot parallel steps of graph ingest (parsing, relabeling, CSR construction).
+// Solvers use their persistent pools instead.
+
+inline size_t default_thread_count() {
+    unsigned int hw = std::thread::hardware_concurrency();
+    return hw == 0 ? 1 : hw;
+}
+
+// Run f(tid) for tid in [0, num_threads), the calling thread takes tid 0, and wait for all of them
+template<class F>
+void run_on_threads(size_t num_threads, F &&f) {
+    if (num_threads <= 1) {
+        f(size_t(0));
+        return;
+    }
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (size_t tid = 1; tid < num_threads; ++tid) {
+        threads.emplace_back([&f, tid] {
+            f(tid);
+        });
+    }
+    f(size_t(0));
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+// Static split of [0, count) into num_threads contiguous blocks, returns the block of tid
+inline std::pair<size_t, size_t> block_range(size_t count, size_t num_threads, size_t tid) {
+    size_t chunk = (count + num_threads - 1) / num_threads;
+    size_t begin = std::min(count, tid * chunk);
+    size_t end = std::min(count, begin + chunk);
+    return {begin, end};
+}
+
+// Stable LSD radix sort of keys on bits [low_bit, high_bit), 8 bits per pass.
+// Each pass histograms one block per thread, turns the histograms into per-thread scatter offsets
+// and scatters in parallel. buffer is scratch space, the sorted keys end up in keys.
+inline void radix_sort(std::vector<uint64_t> &keys, std::vector<uint64_t> &buffer, int low_bit, int high_bit, size_t num_threads = 1) {
+    constexpr int DIGIT_BITS = 8;
+    constexpr size_t RADIX = size_t(1) << DIGIT_BITS;
+    size_t count = keys.size();
+    num_threads = std::max<size_t>(1, std::min(num_threads, count / 65536));
+    buffer.resize(count);
+    std::vector<size_t> histograms(num_threads * RADIX);
+
+    for (int shift = low_bit; shift < high_bit; shift += DIGIT_BITS) {
+        std::fill(histograms.begin(), histograms.end(), 0);
+        run_on_threads(num_threads, [&] (size_t tid) {
+            auto [begin, end] = block_range(count, num_threads, tid);
+            size_t *histogram = histograms.data() + tid * RADIX;
+            for (size_t i = begin; i < end; ++i) {
+                ++histogram[(keys[i] >> shift) & (RADIX - 1)];
+            }
+        });
+
+        // exclusive scan in (digit, thread) order keeps equal digits in their original order
+        size_t running = 0;
+        for (size_t digit = 0; digit < RADIX; ++digit) {
+            for (size_t tid = 0; tid < num_threads; ++tid) {
+                size_t c = histograms[tid * RADIX + digit];
+                histograms[tid * RADIX + digit] = running;
+                running += c;
+            }
+        }
+
+        run_on_threads(num_threads, [&] (size_t tid) {
+            auto [begin, end] = block_range(count, num_threads, tid);
+            size_t *cursor = histograms.data() + tid * RADIX;
+            for (size_t i = begin; i < end; ++i) {
+                buffer[cursor[(keys[i] >> shift) & (RADIX - 1)]++] = keys[i];
+            }
+        });
+        keys.swap(buffer);
+    }
+}
+
+#endif
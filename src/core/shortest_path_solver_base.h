@@ -2,6 +2,9 @@
 #define SHORTEST_PATH_SOLVER_BASE_H
 
 #include <vector>
+#include <string>
+#include <utility>
+#include <cstdint>
 #include "graph.h"
 
 class ShortestPathSolverBase {
@@ -9,6 +12,12 @@ public:
     virtual ~ShortestPathSolverBase() = default;
     virtual std::vector<double> compute(const Graph &graph, int source) const = 0;
     virtual const std::string name() const = 0;
+    // Drop any state a solver keeps between compute() calls on the same graph
+    virtual void release_workspace() const {}
+    // Named event counters of the last compute() call, empty for solvers that keep none
+    virtual std::vector<std::pair<std::string, uint64_t>> last_query_counters() const {
+        return {};
+    }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,51 @@
+#ifndef ATOMIC_MIN_DOUBLE_H
+#define ATOMIC_MIN_DOUBLE_H
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <limits>
+
+// A non-negative double (+inf included) kept as its IEEE-754 bit pattern in an atomic integer.
+// For non-negative doubles the bit patterns order exactly like the values, so write_min() is an
+// integer compare-and-swap loop that can stop as soon as the stored value is not larger.
+// Negative values (including -0.0) must not be stored.
+// Memory ordering is relaxed: the solvers read these values only after a barrier.
+class AtomicMinDouble {
+public:
+    static constexpr double EMPTY = std::numeric_limits<double>::infinity();
+
+    AtomicMinDouble(double value = EMPTY): bits(std::bit_cast<uint64_t>(value)) {}
+
+    double load() const {
+        return std::bit_cast<double>(bits.load(std::memory_order_relaxed));
+    }
+
+    void store(double value) {
+        bits.store(std::bit_cast<uint64_t>(value), std::memory_order_relaxed);
+    }
+
+    // Read the value and leave EMPTY in one step, for readers racing with write_min()
+    double take() {
+        return std::bit_cast<double>(bits.exchange(std::bit_cast<uint64_t>(EMPTY), std::memory_order_relaxed));
+    }
+
+    // Lower the stored value to value if that is smaller. Returns the value seen before:
+    // value was stored iff the result is larger than value. retries counts failed CAS attempts.
+    double write_min(double value, uint64_t &retries) {
+        uint64_t desired = std::bit_cast<uint64_t>(value);
+        uint64_t current = bits.load(std::memory_order_relaxed);
+        while (desired < current) {
+            if (bits.compare_exchange_weak(current, desired, std::memory_order_relaxed)) {
+                break;
+            }
+            ++retries;
+        }
+        return std::bit_cast<double>(current);
+    }
+
+private:
+    std::atomic<uint64_t> bits;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef CONCURRENT_BITMAP_H
+#define CONCURRENT_BITMAP_H
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Fixed-size bit set whose bits can be set and reset concurrently (one atomic word per 64 bits).
+// test_and_set() reads the word first, so setting a bit that is already set costs no atomic write.
+class ConcurrentBitmap {
+public:
+    explicit ConcurrentBitmap(size_t num_bits): num_bits(num_bits), words((num_bits + 63) / 64) {}
+
+    bool test(size_t i) const {
+        return words[i >> 6].load(std::memory_order_relaxed) & mask(i);
+    }
+
+    // Set bit i, returns whether it was set already
+    bool test_and_set(size_t i) {
+        std::atomic<uint64_t> &word = words[i >> 6];
+        if (word.load(std::memory_order_relaxed) & mask(i)) {
+            return true;
+        }
+        return word.fetch_or(mask(i), std::memory_order_relaxed) & mask(i);
+    }
+
+    void reset(size_t i) {
+        words[i >> 6].fetch_and(~mask(i), std::memory_order_relaxed);
+    }
+
+    // not concurrent
+    void clear() {
+        for (auto &word : words) {
+            word.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    size_t size() const {
+        return num_bits;
+    }
+
+private:
+    size_t num_bits;
+    std::vector<std::atomic<uint64_t>> words;
+
+    static uint64_t mask(size_t i) {
+        return uint64_t(1) << (i & 63);
+    }
+};
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef HIERARCHICAL_BITMAP_H
+#define HIERARCHICAL_BITMAP_H
+
+#include <atomic>
+#include <bit>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Bit set with summary levels on top: bit i of level l+1 is set iff word i of level l is non-zero,
+// up to a top level of a single word. find_next() skips 64^l empty bits per word read at level l,
+// so finding the next set bit costs a few word reads however sparse the set is.
+// set() is concurrent (with other set() calls) and reads each word first, so setting a bit that is
+// already set costs no atomic write; reset(), clear() and find_next() must not overlap with set().
+class HierarchicalBitmap {
+public:
+    static constexpr size_t NONE = size_t(-1);
+
+    explicit HierarchicalBitmap(size_t num_bits): num_bits(num_bits) {
+        size_t bits = num_bits;
+        do {
+            size_t words = (bits + 63) / 64;
+            levels.emplace_back(words);
+            bits = words;
+        } while (bits > 1);
+    }
+
+    bool test(size_t i) const {
+        return levels[0][i >> 6].load(std::memory_order_relaxed) & mask(i);
+    }
+
+    // Set bit i and its summary bits; a set summary bit means the ones above are set already
+    void set(size_t i) {
+        for (auto &level : levels) {
+            std::atomic<uint64_t> &word = level[i >> 6];
+            if (word.load(std::memory_order_relaxed) & mask(i)) {
+                return;
+            }
+            word.fetch_or(mask(i), std::memory_order_relaxed);
+            i >>= 6;
+        }
+    }
+
+    // Reset bit i, and the summary bits of the words this empties
+    void reset(size_t i) {
+        for (auto &level : levels) {
+            std::atomic<uint64_t> &word = level[i >> 6];
+            uint64_t value = word.load(std::memory_order_relaxed) & ~mask(i);
+            word.store(value, std::memory_order_relaxed);
+            if (value != 0) {
+                return;
+            }
+            i >>= 6;
+        }
+    }
+
+    void clear() {
+        for (auto &level : levels) {
+            for (auto &word : level) {
+                word.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Smallest set bit at or after i, NONE if there is none
+    size_t find_next(size_t i) const {
+        // climb until a word holds a set bit at or after i
+        size_t l = 0;
+        while (true) {
+            if ((i >> 6) >= levels[l].size()) {
+                return NONE;
+            }
+            uint64_t word = levels[l][i >> 6].load(std::memory_order_relaxed) & (~uint64_t(0) << (i & 63));
+            if (word != 0) {
+                i = (i & ~size_t(63)) | std::countr_zero(word);
+                break;
+            }
+            if (l + 1 == levels.size()) {
+                return NONE;
+            }
+            i = (i >> 6) + 1;
+            ++l;
+        }
+        // descend to the first set bit below it
+        while (l > 0) {
+            --l;
+            i = i * 64 + std::countr_zero(levels[l][i].load(std::memory_order_relaxed));
+        }
+        return i;
+    }
+
+    // Next set bit cyclically after i (i itself last), NONE if no bit is set
+    size_t find_next_cyclic(size_t i) const {
+        size_t next = i + 1 < num_bits ? find_next(i + 1) : NONE;
+        return next != NONE ? next : find_next(0);
+    }
+
+    size_t size() const {
+        return num_bits;
+    }
+
+private:
+    size_t num_bits;
+    std::vector<std::vector<std::atomic<uint64_t>>> levels;
+
+    static uint64_t mask(size_t i) {
+        return uint64_t(1) << (i & 63);
+    }
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef DISSEMINATION_BARRIER_H
+#define DISSEMINATION_BARRIER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "pools/wait_policy.h"
+
+// Dissemination barrier for a fixed set of num_threads threads, tid in [0, num_threads).
+// In round r thread tid signals thread (tid + 2^r) mod num_threads and waits for the signal of
+// (tid - 2^r) mod num_threads; after ceil(log2(num_threads)) rounds every thread has heard from all.
+// There is no shared counter, every flag has a single writer and a single reader, so it scales
+// better than a centralized barrier once many threads arrive at the same time.
+// A flag holds the episode of its last signal; a signaller is at most one episode ahead of its reader.
+// Waiters follow the WaitPolicy (spin, yield, then park on the flag).
+class DisseminationBarrier {
+public:
+    explicit DisseminationBarrier(size_t num_threads): DisseminationBarrier(num_threads, WaitPolicy::for_threads(num_threads)) {}
+
+    DisseminationBarrier(size_t num_threads, WaitPolicy wait_policy)
+        : num_threads(num_threads), num_rounds(0), nodes(num_threads), wait_policy(wait_policy) {
+        while ((size_t(1) << num_rounds) < num_threads) {
+            ++num_rounds;
+        }
+    }
+
+    void arrive_and_wait(size_t tid) {
+        Node &self = nodes[tid];
+        uint32_t episode = ++self.episode;
+        for (size_t round = 0; round < num_rounds; ++round) {
+            std::atomic<uint32_t> &partner = nodes[(tid + (size_t(1) << round)) % num_threads].flags[round];
+            partner.store(episode, std::memory_order_release);
+            partner.notify_one();
+            // episodes wrap around, compare by signed distance
+            wait_until(self.flags[round], [episode] (uint32_t current) {
+                return (int32_t)(current - episode) >= 0;
+            }, wait_policy);
+        }
+    }
+
+private:
+    static constexpr size_t MAX_ROUNDS = 32;
+
+    struct alignas(64) Node {
+        std::atomic<uint32_t> flags[MAX_ROUNDS] = {};
+        uint32_t episode = 0;
+    };
+
+    size_t num_threads;
+    size_t num_rounds;
+    std::vector<Node> nodes;
+    WaitPolicy wait_policy;
+};
+
+#endif
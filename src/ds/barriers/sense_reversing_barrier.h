@@ -0,0 +1,50 @@
+#ifndef SENSE_REVERSING_BARRIER_H
+#define SENSE_REVERSING_BARRIER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "pools/wait_policy.h"
+
+// Centralized sense-reversing barrier for a fixed set of num_threads threads, tid in [0, num_threads).
+// Every thread flips its own sense and decrements the shared counter, the last one to arrive resets
+// the counter and publishes the new sense, which releases the others. One atomic RMW per arrival and
+// a single cache line everyone waits on, which makes it the cheapest barrier at low thread counts.
+// Waiters follow the WaitPolicy (spin, yield, then park on the sense).
+class SenseReversingBarrier {
+public:
+    explicit SenseReversingBarrier(size_t num_threads): SenseReversingBarrier(num_threads, WaitPolicy::for_threads(num_threads)) {}
+
+    SenseReversingBarrier(size_t num_threads, WaitPolicy wait_policy)
+        : num_threads(num_threads), local_sense(num_threads), wait_policy(wait_policy) {
+        remaining.store(num_threads, std::memory_order_relaxed);
+    }
+
+    void arrive_and_wait(size_t tid) {
+        uint32_t sense = local_sense[tid].value ^= 1;
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            remaining.store(num_threads, std::memory_order_relaxed);
+            global_sense.store(sense, std::memory_order_release);
+            global_sense.notify_all();
+        }
+        else {
+            wait_until(global_sense, [sense] (uint32_t current) {
+                return current == sense;
+            }, wait_policy);
+        }
+    }
+
+private:
+    struct alignas(64) LocalSense {
+        uint32_t value = 0;
+    };
+
+    size_t num_threads;
+    alignas(64) std::atomic<size_t> remaining{0};
+    alignas(64) std::atomic<uint32_t> global_sense{0};
+    std::vector<LocalSense> local_sense;
+    WaitPolicy wait_policy;
+};
+
+#endif
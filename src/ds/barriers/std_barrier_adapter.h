@@ -0,0 +1,20 @@
+#ifndef STD_BARRIER_ADAPTER_H
+#define STD_BARRIER_ADAPTER_H
+
+#include <barrier>
+#include <cstddef>
+
+// std::barrier behind the arrive_and_wait(tid) interface of the barriers in this directory
+class StdBarrier {
+public:
+    explicit StdBarrier(size_t num_threads): barrier(num_threads) {}
+
+    void arrive_and_wait(size_t) {
+        barrier.arrive_and_wait();
+    }
+
+private:
+    std::barrier<> barrier;
+};
+
+#endif
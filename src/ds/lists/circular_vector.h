@@ -4,10 +4,12 @@
 #include <atomic>
 #include <new>
 #include <utility>
+#include "huge_pages.h"
 
 // Vector that supports concurrent insertion and non-concurrent clear
-// Note: use operator new[] and placement new to avoid computation cost when creating std::vector<CircularVector>
+// Note: use raw pages and placement new to avoid computation cost when creating std::vector<CircularVector>
 // Constructor only called when referred
+// Storage comes from allocate_pages(), so large vectors are backed by huge pages
 
 template<class E>
 class CircularVector {
@@ -15,7 +17,7 @@ public:
     CircularVector() : data(nullptr), capacity(0) {}
     
     CircularVector(size_t capacity_): capacity(capacity_ + 1) {
-        data = static_cast<E*>(operator new[](capacity * sizeof(E)));
+        data = static_cast<E*>(allocate_pages(capacity * sizeof(E)));
     }
 
     CircularVector(const CircularVector&) = delete;
@@ -37,14 +39,14 @@ public:
 
     ~CircularVector() {
         if (data) {
-            operator delete[](data);
+            free_pages(data, capacity * sizeof(E));
         }
     }
 
     CircularVector& operator=(CircularVector& other) {
         if (this != &other) {
             if (data) {
-                operator delete[](data);
+                free_pages(data, capacity * sizeof(E));
             }
             
             data = other.data;
@@ -62,7 +64,7 @@ public:
         if (this != &other) {
             // Clean up current data
             if (data) {
-                operator delete[](data);
+                free_pages(data, capacity * sizeof(E));
             }
             
             // Move from other
@@ -0,0 +1,85 @@
+#ifndef FIRST_TOUCH_ARRAY_H
+#define FIRST_TOUCH_ARRAY_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include "huge_pages.h"
+
+// Fixed-size array whose elements are constructed by the threads that use them.
+// The constructor only reserves memory, so no page is touched; construct(first, last, args...) builds
+// a range in place. Linux places a page on the NUMA node of the thread that writes it first, so if
+// every worker constructs the range it owns, the array ends up partitioned across the sockets.
+// Every element must be constructed before it is used. Large arrays are backed by huge pages (see huge_pages.h).
+template<class T>
+class FirstTouchArray {
+    static_assert(std::is_trivially_destructible_v<T>, "elements are never destroyed one by one");
+
+public:
+    FirstTouchArray() = default;
+
+    explicit FirstTouchArray(size_t count)
+        : count(count), items(count == 0 ? nullptr : static_cast<T*>(allocate_pages(count * sizeof(T))), Free{count}) {}
+
+    template<class... Args>
+    void construct(size_t first, size_t last, const Args&... args) {
+        for (size_t i = first; i < last; ++i) {
+            ::new (static_cast<void*>(items.get() + i)) T(args...);
+        }
+    }
+
+    T &operator[](size_t i) {
+        return items[i];
+    }
+
+    const T &operator[](size_t i) const {
+        return items[i];
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    T *data() {
+        return items.get();
+    }
+
+    const T *data() const {
+        return items.get();
+    }
+
+    T *begin() {
+        return items.get();
+    }
+
+    T *end() {
+        return items.get() + count;
+    }
+
+    const T *begin() const {
+        return items.get();
+    }
+
+    const T *end() const {
+        return items.get() + count;
+    }
+
+private:
+    struct Free {
+        size_t count = 0;
+
+        void operator()(T *p) const {
+            free_pages(p, count * sizeof(T));
+        }
+    };
+
+    size_t count = 0;
+    std::unique_ptr<T[], Free> items;
+};
+
+#endif
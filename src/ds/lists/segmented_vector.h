@@ -0,0 +1,190 @@
+#ifndef SEGMENTED_VECTOR_H
+#define SEGMENTED_VECTOR_H
+
+#include <atomic>
+#include <new>
+#include <bit>
+#include <thread>
+#include <utility>
+#include <cstddef>
+
+// Segments of geometrically growing size shared by every SegmentedVector built on the pool.
+// Segment class s holds (BASE << s) elements. Free segments are kept on one lock-free stack per class
+// (the link is stored in the segment itself), so emptied buckets hand their memory to the buckets still growing.
+// acquire() may run concurrently with other acquire() calls, release() must not run concurrently with acquire():
+// pops alone cannot suffer from ABA, which is what keeps the stacks simple.
+template<class E>
+class SegmentPool {
+public:
+    static constexpr size_t BASE_BITS = 6;
+    static constexpr size_t BASE = size_t(1) << BASE_BITS;
+    static constexpr size_t MAX_SEGMENTS = 40;
+
+    static_assert(sizeof(E) * BASE >= sizeof(void*), "segment too small to hold the free-list link");
+
+    SegmentPool() = default;
+    SegmentPool(const SegmentPool&) = delete;
+    SegmentPool& operator=(const SegmentPool&) = delete;
+
+    ~SegmentPool() {
+        for (size_t s = 0; s < MAX_SEGMENTS; ++s) {
+            FreeNode *node = free_lists[s].load();
+            while (node != nullptr) {
+                FreeNode *next = node->next;
+                operator delete[](static_cast<void*>(node));
+                node = next;
+            }
+        }
+    }
+
+    static constexpr size_t segment_size(size_t s) {
+        return BASE << s;
+    }
+
+    E* acquire(size_t s) {
+        std::atomic<FreeNode*> &head = free_lists[s];
+        FreeNode *node = head.load(std::memory_order_acquire);
+        while (node != nullptr && !head.compare_exchange_weak(node, node->next, std::memory_order_acquire));
+        if (node != nullptr) {
+            return reinterpret_cast<E*>(node);
+        }
+        allocated.fetch_add(segment_size(s) * sizeof(E), std::memory_order_relaxed);
+        return static_cast<E*>(operator new[](segment_size(s) * sizeof(E)));
+    }
+
+    void release(size_t s, E *segment) {
+        FreeNode *node = new (segment) FreeNode;
+        node->next = free_lists[s].load(std::memory_order_relaxed);
+        while (!free_lists[s].compare_exchange_weak(node->next, node, std::memory_order_release));
+    }
+
+    // bytes obtained from the allocator so far (live + cached segments)
+    size_t allocated_bytes() const {
+        return allocated.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct FreeNode {
+        FreeNode *next;
+    };
+
+    std::atomic<FreeNode*> free_lists[MAX_SEGMENTS] = {};
+    std::atomic<size_t> allocated{0};
+};
+
+// Drop-in replacement for CircularVector whose memory follows the number of live entries
+// instead of a capacity fixed at construction.
+// push() is concurrent: one fetch_add picks the slot, the thread that lands on the first slot of a
+// missing segment installs it while the others landing in that segment wait for it.
+// reserve_block() hands out a block of slots the same way, for callers that batch their appends.
+// clear() (non-concurrent) returns every segment but the first one to the shared pool.
+template<class E>
+class SegmentedVector {
+public:
+    using Pool = SegmentPool<E>;
+
+    explicit SegmentedVector(Pool &pool): pool(&pool) {}
+
+    SegmentedVector(const SegmentedVector&) = delete;
+    SegmentedVector& operator=(const SegmentedVector&) = delete;
+
+    SegmentedVector(SegmentedVector&& other) noexcept: pool(other.pool), tail(other.tail.load()) {
+        for (size_t s = 0; s < Pool::MAX_SEGMENTS; ++s) {
+            segments[s].store(other.segments[s].load());
+            other.segments[s].store(nullptr);
+        }
+        other.tail = 0;
+    }
+
+    ~SegmentedVector() {
+        release_from(0);
+    }
+
+    size_t push(const E &value) {
+        size_t current_tail = tail.fetch_add(1);
+        new (slot(current_tail, true)) E(value);
+        return current_tail;
+    }
+
+    size_t push(E &&value) {
+        size_t current_tail = tail.fetch_add(1);
+        new (slot(current_tail, true)) E(std::move(value));
+        return current_tail;
+    }
+
+    // Claim count consecutive slots with a single fetch_add and return the index of the first one.
+    // Segments starting inside the block are installed by the caller; it must write every claimed slot
+    // (before the next non-concurrent read) since readers cannot tell unwritten slots apart.
+    size_t reserve_block(size_t count) {
+        size_t first = tail.fetch_add(count);
+        for (size_t index = first; index < first + count; index = segment_start(segment_of(index) + 1)) {
+            slot(index, true);
+        }
+        return first;
+    }
+
+    void clear() {
+        release_from(1);
+        tail = 0;
+    }
+
+    const E& operator[](size_t index) const {
+        return *const_cast<SegmentedVector*>(this)->slot(index, false);
+    }
+
+    E& operator[](size_t index) {
+        return *slot(index, false);
+    }
+
+    bool empty() const {
+        return tail == 0;
+    }
+
+    size_t size() const {
+        return tail;
+    }
+
+private:
+    Pool *pool;
+    std::atomic<E*> segments[Pool::MAX_SEGMENTS] = {};
+    std::atomic<size_t> tail{0};
+
+    static size_t segment_of(size_t index) {
+        return std::bit_width((index >> Pool::BASE_BITS) + 1) - 1;
+    }
+
+    static size_t segment_start(size_t s) {
+        return Pool::BASE * ((size_t(1) << s) - 1);
+    }
+
+    E* slot(size_t index, bool for_push) {
+        size_t s = segment_of(index);
+        size_t start = segment_start(s);
+        E *segment = segments[s].load(std::memory_order_acquire);
+        if (for_push && segment == nullptr) {
+            if (index == start) {
+                segment = pool->acquire(s);
+                segments[s].store(segment, std::memory_order_release);
+            }
+            else {
+                while ((segment = segments[s].load(std::memory_order_acquire)) == nullptr) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+        return segment + (index - start);
+    }
+
+    void release_from(size_t first) {
+        for (size_t s = first; s < Pool::MAX_SEGMENTS; ++s) {
+            E *segment = segments[s].load(std::memory_order_relaxed);
+            if (segment == nullptr) {
+                break;
+            }
+            pool->release(s, segment);
+            segments[s].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef THREAD_LOCAL_LISTS_H
+#define THREAD_LOCAL_LISTS_H
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+// One append-only list per thread, read back as their concatenation.
+// push(tid, x) touches only the list of tid, each list header sits on its own cache line,
+// so appends from different threads never contend. Between phases scan() computes the offset
+// of every list in the concatenation, after which for_each(begin, end) visits any index range of it.
+// Without scan(), for_each_share() visits one part of a static partition that every thread computes alone.
+// push() is concurrent for distinct tids; scan(), size(), for_each(), for_each_share() and clear() must not
+// overlap with push().
+template<class E>
+class ThreadLocalLists {
+public:
+    explicit ThreadLocalLists(size_t num_lists): lists(num_lists), offsets(num_lists + 1, 0) {}
+
+    void push(size_t tid, const E &value) {
+        lists[tid].items.push_back(value);
+    }
+
+    // Offsets of the lists in the concatenation, returns its size
+    size_t scan() {
+        for (size_t t = 0; t < lists.size(); ++t) {
+            offsets[t + 1] = offsets[t] + lists[t].items.size();
+        }
+        return offsets.back();
+    }
+
+    // f(item) for the items [begin, end) of the concatenation, scan() must be up to date
+    template<class F>
+    void for_each(size_t begin, size_t end, F &&f) const {
+        size_t t = std::upper_bound(offsets.begin(), offsets.end(), begin) - offsets.begin() - 1;
+        for (size_t i = begin; i < end; ++t) {
+            size_t stop = std::min(end, offsets[t + 1]);
+            const E *items = lists[t].items.data();
+            for (; i < stop; ++i) {
+                f(items[i - offsets[t]]);
+            }
+        }
+    }
+
+    // Size of the concatenation, read-only unlike scan()
+    size_t size() const {
+        size_t total = 0;
+        for (const auto &list : lists) {
+            total += list.items.size();
+        }
+        return total;
+    }
+
+    // f(item) for part (0 .. parts - 1) of a static partition of the concatenation, the items
+    // [part * total / parts, (part + 1) * total / parts) for total = size(). Finds the range by walking
+    // the list sizes instead of the offsets of scan(), so the parts can be visited concurrently.
+    template<class F>
+    void for_each_share(size_t part, size_t parts, size_t total, F &&f) const {
+        size_t begin = part * total / parts, end = (part + 1) * total / parts;
+        size_t offset = 0;
+        for (size_t t = 0; t < lists.size() && offset < end; ++t) {
+            const std::vector<E> &items = lists[t].items;
+            size_t first = std::max(begin, offset), stop = std::min(end, offset + items.size());
+            for (size_t i = first; i < stop; ++i) {
+                f(items[i - offset]);
+            }
+            offset += items.size();
+        }
+    }
+
+    // empties the list of tid only, concurrent for distinct tids; scan() must be redone before for_each()
+    void clear(size_t tid) {
+        lists[tid].items.clear();
+    }
+
+    // empties every list but keeps its capacity
+    void clear() {
+        for (auto &list : lists) {
+            list.items.clear();
+        }
+        std::fill(offsets.begin(), offsets.end(), 0);
+    }
+
+private:
+    struct alignas(64) List {
+        std::vector<E> items;
+    };
+
+    std::vector<List> lists;
+    std::vector<size_t> offsets;
+};
+
+#endif
@@ -3,9 +3,12 @@
 
 #include <vector>
 #include <thread>
-#include <functional>
+#include <tuple>
 #include <barrier>
 #include <type_traits>
+#include "inline_task.h"
+#include "wait_policy.h"
+#include "thread_placement.h"
 // #include <cassert>
 
 // FASTPOOL IS NOT THREAD-SAFE! (ONLY ONE THREAD SUPPOSED TO HAVE ACCESS TO THE THREAD POOL) 
@@ -13,9 +16,11 @@ template<template<class> class QueueType>
 class FastPool {
 public:
     enum class ControlSignal { OK, STOP };
-    using TaskType = std::function<ControlSignal()>;
+    using TaskType = InlineTask<ControlSignal>;
     
-    explicit FastPool(unsigned int num_workers);
+    explicit FastPool(unsigned int num_workers): FastPool(num_workers, WaitPolicy::for_threads(num_workers + 1)) {}
+    // worker i is pinned to slot i + 1 of placement
+    FastPool(unsigned int num_workers, WaitPolicy wait_policy, const ThreadPlacement &placement = default_thread_placement());
     ~FastPool();
 
     void start();
@@ -38,20 +43,24 @@ private:
     std::atomic<bool> running{false};
 
     std::barrier<> barrier;
+    WaitPolicy wait_policy;
 
     void do_work();
+    bool next_task(TaskType &task);
 
 };
 
 template<template<class> class QueueType>
-FastPool<QueueType>::FastPool(unsigned int num_workers) 
+FastPool<QueueType>::FastPool(unsigned int num_workers, WaitPolicy wait_policy, const ThreadPlacement &placement) 
     : num_workers(num_workers),
       owner(std::this_thread::get_id()),
-      barrier(num_workers + 1) {
+      barrier(num_workers + 1),
+      wait_policy(wait_policy) {
     
     workers.resize(num_workers);
     for (size_t i = 0; i < num_workers; ++i) {
         workers[i] = std::thread(&FastPool::do_work, this);
+        placement.pin(workers[i].native_handle(), i + 1);
     }
 }
 
@@ -82,7 +91,7 @@ template<template<class> class QueueType>
 void FastPool<QueueType>::do_work() {
     while (true) {
         TaskType task;
-        if (tasks.pop(task)) {
+        if (next_task(task)) {
             ControlSignal signal = task();
             if (signal == ControlSignal::STOP) {
                 return;
@@ -91,6 +100,18 @@ void FastPool<QueueType>::do_work() {
     }
 }
 
+// Poll the queue through the spin and yield stages of the wait policy before a blocking pop parks the worker.
+// Queues without try_pop() go straight to pop().
+template<template<class> class QueueType>
+bool FastPool<QueueType>::next_task(TaskType &task) {
+    if constexpr (requires { tasks.try_pop(task); }) {
+        if (spin_then_yield(wait_policy, [&] { return tasks.try_pop(task); })) {
+            return true;
+        }
+    }
+    return tasks.pop(task);
+}
+
 template<template<class> class QueueType>
 template<class F, class... Args>
 void FastPool<QueueType>::push(F&& f, Args&&... args) {
@@ -3,43 +3,59 @@
 
 #include <vector>
 #include <thread>
-#include <functional>
+#include <tuple>
 #include <type_traits>
 #include <atomic>
 #include <iostream>
-#include <barrier>
+#include <cstdint>
+#include <algorithm>
+#include "inline_task.h"
+#include "wait_policy.h"
+#include "thread_placement.h"
+#include "barriers/sense_reversing_barrier.h"
 // #include <cassert>
 
 // FASTPOOL IS NOT THREAD-SAFE! (ONLY ONE THREAD SUPPOSED TO HAVE ACCESS TO THE THREAD POOL) 
-class FixedTaskPool {
+// Barrier is any barrier of src/ds/barriers for num_workers + 1 threads: worker i arrives as tid i,
+// the submitting thread as tid num_workers (through arrive_and_wait()).
+template<class Barrier>
+class BasicFixedTaskPool {
 public:
     enum class ControlSignal { OK, STOP };
-    using TaskType = std::function<bool()>;
+    using TaskType = InlineTask<bool>;
+    using BarrierType = Barrier;
     
-    explicit FixedTaskPool(size_t num_workers, std::barrier<> &barrier): num_workers(num_workers), tasks(num_workers), ready(num_workers) {
+    explicit BasicFixedTaskPool(size_t num_workers)
+        : BasicFixedTaskPool(num_workers, WaitPolicy::for_threads(num_workers + 1)) {}
+
+    // wait_policy applies to idle workers and, if it takes one, to the barrier.
+    // Worker i is pinned to slot i + 1 of placement.
+    BasicFixedTaskPool(size_t num_workers, WaitPolicy wait_policy, const ThreadPlacement &placement = default_thread_placement())
+        : num_workers(num_workers), tasks(num_workers), ready(num_workers), wait_policy(wait_policy), ranges(num_workers),
+          barrier(make_barrier(num_workers + 1, wait_policy)) {
+        set_worker_nodes(placement);
         for (size_t i = 0; i < num_workers; ++i) {
-            ready[i].store(false);
-            workers.emplace_back([this, i, &barrier] {
+            workers.emplace_back([this, i] {
                 while (true) {
-                    ready[i].wait(false);
+                    wait_while_equal(ready[i].flag, false, this->wait_policy);
                     if (!tasks[i]()) {
                         return;
                     }
-                    ready[i].store(false);
-                    barrier.arrive_and_wait();
+                    ready[i].flag.store(false, std::memory_order_relaxed);
+                    barrier.arrive_and_wait(i);
                 }
             });
+            placement.pin(workers.back().native_handle(), i + 1);
         }
     }
 
-    ~FixedTaskPool() {
+    ~BasicFixedTaskPool() {
         if (!stopped) {
             for (size_t i = 0; i < num_workers; ++i) {
                 tasks[i] = ([] {
                     return false;
                 });
-                ready[i].store(true);
-                ready[i].notify_one();
+                signal(i);
             }
             for (size_t i = 0; i < num_workers; ++i) {
                 workers[i].join();
@@ -47,16 +63,138 @@ public:
         }
     }
     
+    // The task is stored inline in the slot of tid, so together with its arguments it must fit in an InlineTask
     template <class F, class... Args>
     void push(size_t tid, F&& f, Args&&... args) {
-        tasks[tid] = ([f = std::forward<F>(f), 
-                    args_tuple = std::tuple<std::decay_t<Args>...>(std::forward<Args>(args)...)]
-                    () noexcept {
-            std::apply(std::move(f), std::move(args_tuple));
-            return true;
-        });
-        ready[tid].store(true);
-        ready[tid].notify_one();
+        if constexpr (sizeof...(Args) == 0) {
+            tasks[tid] = ([f = std::forward<F>(f)] () mutable noexcept {
+                f();
+                return true;
+            });
+        }
+        else {
+            tasks[tid] = ([f = std::forward<F>(f), 
+                        args_tuple = std::tuple<std::decay_t<Args>...>(std::forward<Args>(args)...)]
+                        () mutable noexcept {
+                std::apply(std::move(f), std::move(args_tuple));
+                return true;
+            });
+        }
+        signal(tid);
+    }
+
+    // Run body(tid, first, last) once on every worker for its own block of [begin, end) and wait for them.
+    // Blocks are equal contiguous shares and are never stolen, so data a worker first-touches here lives on
+    // its NUMA node. Later parallel_for calls range over other indices (bucket entries, requests), so they
+    // do not route work to the owner of the data it touches.
+    template<class Body>
+    void parallel_for_static(size_t begin, size_t end, Body &&body) {
+        size_t count = end > begin ? end - begin : 0;
+        size_t share = (count + num_workers - 1) / num_workers;
+        for (size_t i = 0; i < num_workers; ++i) {
+            push(i, [i, begin, count, share, &body] {
+                size_t first = std::min(count, i * share);
+                size_t last = std::min(count, first + share);
+                body(i, begin + first, begin + last);
+            });
+        }
+        arrive_and_wait();
+    }
+
+    size_t size() const {
+        return num_workers;
+    }
+
+    // NUMA node of worker i (numbered 0 .. num_nodes() - 1), all 0 unless the workers are pinned
+    size_t worker_node(size_t i) const {
+        return nodes[i];
+    }
+
+    size_t num_nodes() const {
+        return nodes.empty() ? 1 : *std::max_element(nodes.begin(), nodes.end()) + 1;
+    }
+
+    // Run body(tid, chunk_begin, chunk_end) over [begin, end) in chunks of at most grain items on all workers,
+    // then finish(tid) once on every worker, and wait for them at the barrier.
+    // Every worker starts on an equal share of the range and takes chunks from its front; a worker whose share
+    // runs dry steals the back half of another worker's remaining range (all of it when that is at most
+    // one chunk) and goes on from there. Workers on the same NUMA node are robbed first. A range is one packed 64-bit atomic (begin, end), so taking and
+    // stealing are single CAS operations on it.
+    template<class Body, class Finish>
+    void parallel_for(size_t begin, size_t end, size_t grain, Body &&body, Finish &&finish) {
+        grain = std::max<size_t>(1, grain);
+        size_t count = end > begin ? end - begin : 0;
+        // offsets are packed in 32 bits, larger ranges run as consecutive slices
+        const size_t max_slice = size_t(1) << 31;
+        for (size_t slice_begin = 0; slice_begin < count || slice_begin == 0; slice_begin += max_slice) {
+            size_t slice = std::min(max_slice, count - slice_begin);
+            size_t base = begin + slice_begin;
+            size_t share = (slice + num_workers - 1) / num_workers;
+            for (size_t i = 0; i < num_workers; ++i) {
+                uint64_t first = std::min(slice, i * share);
+                uint64_t last = std::min(slice, first + share);
+                ranges[i].bounds.store(pack(first, last), std::memory_order_relaxed);
+            }
+            bool last_slice = slice_begin + slice >= count;
+            for (size_t i = 0; i < num_workers; ++i) {
+                push(i, [this, i, base, grain, last_slice, &body, &finish] {
+                    uint64_t first, last;
+                    while (take_front(i, grain, first, last) || steal(i, grain, first, last)) {
+                        body(i, base + first, base + last);
+                    }
+                    if (last_slice) {
+                        finish(i);
+                    }
+                });
+            }
+            arrive_and_wait();
+            if (last_slice) {
+                break;
+            }
+        }
+    }
+
+    template<class Body>
+    void parallel_for(size_t begin, size_t end, size_t grain, Body &&body) {
+        parallel_for(begin, end, grain, std::forward<Body>(body), [] (size_t) {});
+    }
+
+    // Run body(tid) on every worker (tid 0 .. size() - 1) and on the calling thread (tid size()), then wait
+    // for all of them. The bodies may meet at sync() to run in lockstep (SPMD); each must call it equally often.
+    template<class Body>
+    void run_spmd(Body &&body) {
+        for (size_t i = 0; i < num_workers; ++i) {
+            push(i, [i, &body] {
+                body(i);
+            });
+        }
+        body(num_workers);
+        arrive_and_wait();
+    }
+
+    // Barrier of the run_spmd() bodies, tid as passed to the body
+    void sync(size_t tid) {
+        barrier.arrive_and_wait(tid);
+    }
+
+    // Arrival of the submitting thread at the barrier, returns once every worker finished its task
+    void arrive_and_wait() {
+        barrier.arrive_and_wait(num_workers);
+    }
+
+    // successful steals since the last reset_steal_count()
+    uint64_t steal_count() const {
+        uint64_t total = 0;
+        for (const auto &range : ranges) {
+            total += range.steals;
+        }
+        return total;
+    }
+
+    void reset_steal_count() {
+        for (auto &range : ranges) {
+            range.steals = 0;
+        }
     }
 
     void stop() {
@@ -64,8 +202,7 @@ public:
             tasks[i] = ([] {
                 return false;
             });
-            ready[i].store(true);
-            ready[i].notify_one();
+            signal(i);
         }
         for (size_t i = 0; i < num_workers; ++i) {
             workers[i].join();
@@ -77,9 +214,118 @@ private:
     size_t num_workers;
     std::vector<std::thread> workers;
     std::vector<TaskType> tasks;
-    std::vector<std::atomic<bool>> ready;
+
+    // ready flag of one worker, on its own cache line as the worker spins on it
+    struct alignas(64) ReadyFlag {
+        std::atomic<bool> flag{false};
+    };
+
+    std::vector<ReadyFlag> ready;
+    WaitPolicy wait_policy;
     bool stopped = false;
+
+    // remaining share of one worker in parallel_for, begin in the low and end in the high 32 bits
+    struct alignas(64) WorkRange {
+        std::atomic<uint64_t> bounds{0};
+        uint64_t steals = 0; // written by the owner only
+    };
+
+    std::vector<WorkRange> ranges;
+    // node of every worker, and the order in which a worker looks for victims: own node first, then ring order
+    std::vector<size_t> nodes;
+    std::vector<std::vector<uint32_t>> victims;
+    Barrier barrier;
+
+    static Barrier make_barrier(size_t num_threads, WaitPolicy wait_policy) {
+        if constexpr (std::is_constructible_v<Barrier, size_t, WaitPolicy>) {
+            return Barrier(num_threads, wait_policy);
+        }
+        else {
+            return Barrier(num_threads);
+        }
+    }
+
+    // publish the task of worker i, the notify only costs a wake-up if the worker has parked
+    void signal(size_t i) {
+        ready[i].flag.store(true, std::memory_order_release);
+        ready[i].flag.notify_one();
+    }
+
+    void set_worker_nodes(const ThreadPlacement &placement) {
+        // renumber the nodes in use as 0, 1, ...
+        std::vector<int> seen;
+        for (size_t i = 0; i < num_workers; ++i) {
+            int node = placement.node_for(i + 1);
+            auto it = std::find(seen.begin(), seen.end(), node);
+            nodes.push_back(it - seen.begin());
+            if (it == seen.end()) {
+                seen.push_back(node);
+            }
+        }
+        victims.resize(num_workers);
+        for (size_t i = 0; i < num_workers; ++i) {
+            for (int pass = 0; pass < 2; ++pass) {
+                for (size_t k = 1; k < num_workers; ++k) {
+                    size_t other = (i + k) % num_workers;
+                    if ((nodes[other] == nodes[i]) == (pass == 0)) {
+                        victims[i].push_back(other);
+                    }
+                }
+            }
+        }
+    }
+
+    static uint64_t pack(uint64_t first, uint64_t last) {
+        return first | (last << 32);
+    }
+
+    // Take up to grain items from the front of the worker's own range
+    bool take_front(size_t tid, size_t grain, uint64_t &first, uint64_t &last) {
+        std::atomic<uint64_t> &bounds = ranges[tid].bounds;
+        uint64_t current = bounds.load(std::memory_order_relaxed);
+        while (true) {
+            first = current & 0xffffffffu;
+            last = current >> 32;
+            if (first >= last) {
+                return false;
+            }
+            uint64_t split = std::min<uint64_t>(last, first + grain);
+            if (bounds.compare_exchange_weak(current, pack(split, last), std::memory_order_relaxed)) {
+                last = split;
+                return true;
+            }
+        }
+    }
+
+    // Move the back half of another worker's range into the (empty) own range and take a chunk of it.
+    // Fails once every other range is empty; ranges in transit between workers are finished by their thief.
+    bool steal(size_t tid, size_t grain, uint64_t &first, uint64_t &last) {
+        for (uint32_t other : victims[tid]) {
+            std::atomic<uint64_t> &victim = ranges[other].bounds;
+            uint64_t current = victim.load(std::memory_order_relaxed);
+            while (true) {
+                uint64_t victim_first = current & 0xffffffffu;
+                uint64_t victim_last = current >> 32;
+                if (victim_first >= victim_last) {
+                    break;
+                }
+                uint64_t remaining = victim_last - victim_first;
+                uint64_t mid = remaining <= grain ? victim_first : victim_first + remaining / 2;
+                if (victim.compare_exchange_weak(current, pack(victim_first, mid), std::memory_order_relaxed)) {
+                    ranges[tid].bounds.store(pack(mid, victim_last), std::memory_order_relaxed);
+                    ++ranges[tid].steals;
+                    if (take_front(tid, grain, first, last)) {
+                        return true;
+                    }
+                    // everything was stolen from us in the meantime, look at this victim again
+                    current = victim.load(std::memory_order_relaxed);
+                }
+            }
+        }
+        return false;
+    }
 };
 
+using FixedTaskPool = BasicFixedTaskPool<SenseReversingBarrier>;
 
 #endif
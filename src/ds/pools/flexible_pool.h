@@ -3,20 +3,14 @@
 
 #include <vector>
 #include <thread>
-#include <functional>
-#include <iostream>
-#include <mutex>
-#include <atomic>
-#include <chrono>
-// #include <cassert>
-
-#include <vector>
-#include <thread>
-#include <functional>
+#include <tuple>
 #include <iostream>
 #include <mutex>
 #include <atomic>
 #include <chrono>
+#include "inline_task.h"
+#include "wait_policy.h"
+#include "thread_placement.h"
 // #include <cassert>
 
 // FLEXIBLEPOOL IS NOT THREAD-SAFE! (ONLY ONE THREAD SUPPOSED TO HAVE ACCESS TO THE THREAD POOL) 
@@ -26,10 +20,13 @@ public:
     enum class ControlSignal { OK, RESET, STOP };
 
 
-    using TaskType = std::function<ControlSignal()>;
+    using TaskType = InlineTask<ControlSignal>;
     
-    explicit FlexiblePool(unsigned int num_workers);
-    explicit FlexiblePool(unsigned int num_workers, QueueType<TaskType> &&tasks);
+    explicit FlexiblePool(unsigned int num_workers): FlexiblePool(num_workers, WaitPolicy::for_threads(num_workers + 1)) {}
+    // worker i is pinned to slot i + 1 of placement
+    FlexiblePool(unsigned int num_workers, WaitPolicy wait_policy, const ThreadPlacement &placement = default_thread_placement());
+    explicit FlexiblePool(unsigned int num_workers, QueueType<TaskType> &&tasks): FlexiblePool(num_workers, std::move(tasks), WaitPolicy::for_threads(num_workers + 1)) {}
+    FlexiblePool(unsigned int num_workers, QueueType<TaskType> &&tasks, WaitPolicy wait_policy, const ThreadPlacement &placement = default_thread_placement());
     ~FlexiblePool();
 
     void start();
@@ -53,6 +50,7 @@ private:
     std::atomic<bool> running{false};
 
     std::atomic<size_t> num_active_workers{0};
+    WaitPolicy wait_policy;
 
     void do_work();
 
@@ -100,13 +98,21 @@ template<template<class> class QueueType>
 void FlexiblePool<QueueType>::do_work() {
     // Signal that this worker has reset and is now waiting
     while (true) {
-        running.wait(false);
+        wait_while_equal(running, false, wait_policy);
         num_active_workers.fetch_add(1);
         num_active_workers.notify_all();
 
         while (true) {
             TaskType task;
-            if (tasks.pop(task)) {
+            bool popped;
+            if constexpr (QueueType<TaskType>::is_blocking() && requires { tasks.try_pop(task); }) {
+                // poll before the blocking pop parks the worker
+                popped = spin_then_yield(wait_policy, [&] { return tasks.try_pop(task); }) || tasks.pop(task);
+            }
+            else {
+                popped = tasks.pop(task);
+            }
+            if (popped) {
                 ControlSignal signal = task();
                 if (signal == ControlSignal::STOP) {
                     num_active_workers.fetch_sub(1);
@@ -131,18 +137,20 @@ void FlexiblePool<QueueType>::do_work() {
 }
 
 template<template<class> class QueueType>
-FlexiblePool<QueueType>::FlexiblePool(unsigned int num_workers) : num_workers(num_workers), owner(std::this_thread::get_id()) {
+FlexiblePool<QueueType>::FlexiblePool(unsigned int num_workers, WaitPolicy wait_policy, const ThreadPlacement &placement) : num_workers(num_workers), owner(std::this_thread::get_id()), wait_policy(wait_policy) {
     workers.resize(num_workers);
     for (unsigned int i = 0; i < num_workers; ++i) {
         workers[i] = std::thread(&FlexiblePool::do_work, this);
+        placement.pin(workers[i].native_handle(), i + 1);
     }
 }
 
 template<template<class> class QueueType>
-FlexiblePool<QueueType>::FlexiblePool(unsigned int num_workers, QueueType<TaskType> &&tasks) : num_workers(num_workers), tasks(std::move(tasks)), owner(std::this_thread::get_id()) {
+FlexiblePool<QueueType>::FlexiblePool(unsigned int num_workers, QueueType<TaskType> &&tasks, WaitPolicy wait_policy, const ThreadPlacement &placement) : num_workers(num_workers), tasks(std::move(tasks)), owner(std::this_thread::get_id()), wait_policy(wait_policy) {
     workers.resize(num_workers);
     for (unsigned int i = 0; i < num_workers; ++i) {
         workers[i] = std::thread(&FlexiblePool::do_work, this);
+        placement.pin(workers[i].native_handle(), i + 1);
     }
 }
 
@@ -0,0 +1,127 @@
+#ifndef INLINE_TASK_H
+#define INLINE_TASK_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Task slot for the pools: holds a callable R() in a fixed inline buffer and never allocates.
+// Callables that do not fit are rejected at compile time, capture large state by reference instead.
+// The default capacity makes a slot exactly two cache lines.
+constexpr size_t INLINE_TASK_CAPACITY = 112;
+
+template<class R, size_t Capacity = INLINE_TASK_CAPACITY>
+class InlineTask {
+public:
+    InlineTask() = default;
+
+    template<class F, class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InlineTask>>>
+    InlineTask(F &&f) {
+        emplace(std::forward<F>(f));
+    }
+
+    InlineTask(const InlineTask &other) {
+        copy_from(other);
+    }
+
+    InlineTask(InlineTask &&other) noexcept {
+        move_from(other);
+    }
+
+    InlineTask &operator=(const InlineTask &other) {
+        if (this != &other) {
+            reset();
+            copy_from(other);
+        }
+        return *this;
+    }
+
+    InlineTask &operator=(InlineTask &&other) noexcept {
+        if (this != &other) {
+            reset();
+            move_from(other);
+        }
+        return *this;
+    }
+
+    template<class F, class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InlineTask>>>
+    InlineTask &operator=(F &&f) {
+        reset();
+        emplace(std::forward<F>(f));
+        return *this;
+    }
+
+    ~InlineTask() {
+        reset();
+    }
+
+    R operator()() {
+        return invoke(storage);
+    }
+
+    explicit operator bool() const {
+        return invoke != nullptr;
+    }
+
+    void reset() {
+        if (manage != nullptr) {
+            manage(Op::DESTROY, storage, nullptr);
+            manage = nullptr;
+            invoke = nullptr;
+        }
+    }
+
+private:
+    enum class Op { COPY, MOVE, DESTROY };
+
+    alignas(alignof(std::max_align_t)) unsigned char storage[Capacity];
+    R (*invoke)(void*) = nullptr;
+    void (*manage)(Op, void*, void*) = nullptr;
+
+    template<class F>
+    void emplace(F &&f) {
+        using Fn = std::decay_t<F>;
+        static_assert(sizeof(Fn) <= Capacity, "task does not fit in the inline slot, capture by reference");
+        static_assert(alignof(Fn) <= alignof(std::max_align_t), "task is over-aligned for the inline slot");
+        static_assert(std::is_copy_constructible_v<Fn>, "tasks are copied by some queues");
+        ::new (static_cast<void*>(storage)) Fn(std::forward<F>(f));
+        invoke = [] (void *p) -> R {
+            return (*static_cast<Fn*>(p))();
+        };
+        manage = [] (Op op, void *dst, void *src) {
+            switch (op) {
+            case Op::COPY:
+                ::new (dst) Fn(*static_cast<const Fn*>(src));
+                break;
+            case Op::MOVE:
+                ::new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+                static_cast<Fn*>(src)->~Fn();
+                break;
+            case Op::DESTROY:
+                static_cast<Fn*>(dst)->~Fn();
+                break;
+            }
+        };
+    }
+
+    void copy_from(const InlineTask &other) {
+        if (other.manage != nullptr) {
+            other.manage(Op::COPY, storage, const_cast<unsigned char*>(other.storage));
+            invoke = other.invoke;
+            manage = other.manage;
+        }
+    }
+
+    void move_from(InlineTask &other) {
+        if (other.manage != nullptr) {
+            other.manage(Op::MOVE, storage, other.storage);
+            invoke = other.invoke;
+            manage = other.manage;
+            other.invoke = nullptr;
+            other.manage = nullptr;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,233 @@
+#ifndef THREAD_PLACEMENT_H
+#define THREAD_PLACEMENT_H
+
+#include <string>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <tuple>
+#include <cstddef>
+#include <cctype>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+
+// One CPU the process may run on, with its place in the machine topology (from /sys/devices/system/cpu)
+struct CpuInfo {
+    int cpu;
+    int core;    // core_id, unique within a package
+    int package; // physical_package_id (socket)
+    int node;    // NUMA node, 0 if unknown
+};
+
+// CPUs of the process affinity mask in increasing id order. Missing sysfs entries fall back to
+// one core per CPU on package and node 0.
+inline std::vector<CpuInfo> detect_cpu_topology() {
+    auto read_int = [] (const std::string &path, int fallback) {
+        std::ifstream in(path);
+        int value;
+        return (in >> value) ? value : fallback;
+    };
+
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) != 0) {
+        return {};
+    }
+    std::vector<CpuInfo> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &mask)) {
+            continue;
+        }
+        std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+        CpuInfo info{cpu, read_int(dir + "/topology/core_id", cpu), read_int(dir + "/topology/physical_package_id", 0), 0};
+        if (DIR *entries = opendir(dir.c_str())) {
+            while (struct dirent *entry = readdir(entries)) {
+                std::string name = entry->d_name;
+                if (name.size() > 4 && name.compare(0, 4, "node") == 0 && std::all_of(name.begin() + 4, name.end(), ::isdigit)) {
+                    info.node = std::stoi(name.substr(4));
+                }
+            }
+            closedir(entries);
+        }
+        cpus.push_back(info);
+    }
+    return cpus;
+}
+
+// Where pool threads run. Slot 0 is the thread that submits work, worker i of a pool takes slot i + 1,
+// and slot s is pinned to cpus[s % cpus.size()]:
+//   NONE      no pinning (the default)
+//   COMPACT   fill a package core by core, SMT siblings next to each other
+//   SCATTER   round-robin over the packages, one thread per physical core before any sibling is used
+//   CORES     one CPU per physical core in compact order, siblings stay idle
+//   EXPLICIT  the given CPU list, in order
+class ThreadPlacement {
+public:
+    enum class Kind { NONE, COMPACT, SCATTER, CORES, EXPLICIT };
+
+    ThreadPlacement() = default;
+
+    static ThreadPlacement make(Kind kind, std::vector<int> explicit_cpus = {}) {
+        ThreadPlacement placement;
+        placement.kind = kind;
+        std::vector<CpuInfo> topology = detect_cpu_topology();
+        if (kind == Kind::EXPLICIT) {
+            placement.cpus = std::move(explicit_cpus);
+        }
+        else if (kind != Kind::NONE) {
+            placement.cpus = cpu_order(kind, topology);
+        }
+        for (int cpu : placement.cpus) {
+            auto it = std::find_if(topology.begin(), topology.end(), [cpu] (const CpuInfo &info) {
+                return info.cpu == cpu;
+            });
+            placement.nodes.push_back(it == topology.end() ? 0 : it->node);
+        }
+        return placement;
+    }
+
+    // "none", "compact", "scatter", "cores" or a CPU list such as "0,2,8-11".
+    // Returns false (and reports why) if spec is malformed.
+    static bool parse(const std::string &spec, ThreadPlacement &placement) {
+        if (spec == "none" || spec == "compact" || spec == "scatter" || spec == "cores") {
+            placement = make(spec == "none" ? Kind::NONE : spec == "compact" ? Kind::COMPACT : spec == "scatter" ? Kind::SCATTER : Kind::CORES);
+            return true;
+        }
+        std::vector<int> list;
+        size_t pos = 0;
+        while (pos < spec.size()) {
+            size_t comma = spec.find(',', pos);
+            std::string item = spec.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+            size_t dash = item.find('-');
+            int first, last;
+            if (item.empty() || item.find_first_not_of("0123456789-") != std::string::npos ||
+                !parse_cpu(item.substr(0, dash), first) ||
+                !parse_cpu(dash == std::string::npos ? item : item.substr(dash + 1), last) || last < first) {
+                std::cerr << "Error: invalid CPU list entry '" << item << "' in affinity '" << spec << "'" << std::endl;
+                return false;
+            }
+            for (int cpu = first; cpu <= last; ++cpu) {
+                list.push_back(cpu);
+            }
+            if (comma == std::string::npos) {
+                break;
+            }
+            pos = comma + 1;
+        }
+        if (list.empty()) {
+            std::cerr << "Error: empty affinity '" << spec << "'" << std::endl;
+            return false;
+        }
+        placement = make(Kind::EXPLICIT, std::move(list));
+        return true;
+    }
+
+    bool enabled() const {
+        return kind != Kind::NONE && !cpus.empty();
+    }
+
+    // CPU of slot, -1 without pinning
+    int cpu_for(size_t slot) const {
+        return enabled() ? cpus[slot % cpus.size()] : -1;
+    }
+
+    // NUMA node of the CPU of slot, 0 without pinning
+    int node_for(size_t slot) const {
+        return enabled() ? nodes[slot % nodes.size()] : 0;
+    }
+
+    // Pin a thread to the CPU of slot, a failure is reported but not fatal
+    bool pin(std::thread::native_handle_type handle, size_t slot) const {
+        int cpu = cpu_for(slot);
+        if (cpu < 0) {
+            return true;
+        }
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        CPU_SET(cpu, &mask);
+        int error = pthread_setaffinity_np(handle, sizeof(mask), &mask);
+        if (error != 0) {
+            std::cerr << "Warning: could not pin a thread to CPU " << cpu << " (error " << error << ")" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool pin_current_thread(size_t slot) const {
+        return pin(pthread_self(), slot);
+    }
+
+    std::string describe() const {
+        static const char *names[] = {"none", "compact", "scatter", "cores", "explicit"};
+        std::string result = names[(int)kind];
+        if (enabled()) {
+            result += " (cpus";
+            for (size_t i = 0; i < cpus.size(); ++i) {
+                result += (i == 0 ? " " : ",") + std::to_string(cpus[i]);
+            }
+            result += ")";
+        }
+        return result;
+    }
+
+private:
+    Kind kind = Kind::NONE;
+    std::vector<int> cpus;
+    std::vector<int> nodes; // node of every entry of cpus
+
+    static bool parse_cpu(const std::string &text, int &cpu) {
+        if (text.empty() || text.size() > 6 || text.find('-') != std::string::npos) {
+            return false;
+        }
+        cpu = std::stoi(text);
+        return cpu < CPU_SETSIZE;
+    }
+
+    static std::vector<int> cpu_order(Kind kind, std::vector<CpuInfo> topology) {
+        std::sort(topology.begin(), topology.end(), [] (const CpuInfo &a, const CpuInfo &b) {
+            return std::tie(a.node, a.package, a.core, a.cpu) < std::tie(b.node, b.package, b.core, b.cpu);
+        });
+        // rank of every CPU among its core's siblings and of its core within its package
+        std::vector<std::tuple<int, int, int, int>> keys; // (sibling, core rank, package, cpu)
+        for (size_t i = 0, core_rank = 0; i < topology.size(); ++i) {
+            const CpuInfo &cpu = topology[i];
+            bool new_package = i == 0 || cpu.package != topology[i - 1].package || cpu.node != topology[i - 1].node;
+            bool new_core = new_package || cpu.core != topology[i - 1].core;
+            core_rank = new_package ? 0 : core_rank + new_core;
+            int sibling = new_core ? 0 : std::get<0>(keys.back()) + 1;
+            keys.emplace_back(sibling, (int)core_rank, cpu.package, cpu.cpu);
+        }
+
+        std::vector<int> order;
+        if (kind == Kind::COMPACT) {
+            for (const auto &cpu : topology) {
+                order.push_back(cpu.cpu);
+            }
+        }
+        else if (kind == Kind::CORES) {
+            for (const auto &[sibling, core_rank, package, cpu] : keys) {
+                if (sibling == 0) {
+                    order.push_back(cpu);
+                }
+            }
+        }
+        else {
+            std::sort(keys.begin(), keys.end());
+            for (const auto &key : keys) {
+                order.push_back(std::get<3>(key));
+            }
+        }
+        return order;
+    }
+};
+
+// Placement pools use unless they are given one, set it before the solvers create their workspaces
+inline ThreadPlacement &default_thread_placement() {
+    static ThreadPlacement placement;
+    return placement;
+}
+
+#endif
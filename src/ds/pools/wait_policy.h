@@ -0,0 +1,77 @@
+#ifndef WAIT_POLICY_H
+#define WAIT_POLICY_H
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+// How an idle worker waits for its next task: spin_iterations polls with a pause instruction,
+// then yield_iterations polls with a yield, then park (atomic wait / blocking pop).
+// Spinning hides the futex wake-up between short phases but burns the core, so it only pays off
+// with at most one thread per core; WaitPolicy::park_only() restores plain blocking.
+struct WaitPolicy {
+    unsigned int spin_iterations = 1024;
+    unsigned int yield_iterations = 32;
+
+    static WaitPolicy park_only() {
+        return {0, 0};
+    }
+
+    // default policy of a pool running num_threads threads: park only when they oversubscribe the cores
+    static WaitPolicy for_threads(size_t num_threads) {
+        unsigned int cores = std::thread::hardware_concurrency();
+        return cores != 0 && num_threads > cores ? park_only() : WaitPolicy{};
+    }
+};
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Poll ready() through the spin and yield stages, true as soon as it returns true.
+// false means the caller should park.
+template<class Ready>
+bool spin_then_yield(const WaitPolicy &policy, Ready &&ready) {
+    for (unsigned int i = 0; i < policy.spin_iterations; ++i) {
+        if (ready()) {
+            return true;
+        }
+        cpu_relax();
+    }
+    for (unsigned int i = 0; i < policy.yield_iterations; ++i) {
+        if (ready()) {
+            return true;
+        }
+        std::this_thread::yield();
+    }
+    return ready();
+}
+
+// Wait until done(value) holds. Writers must notify after every store a waiter may be parked on.
+template<class T, class Done>
+void wait_until(const std::atomic<T> &value, Done &&done, const WaitPolicy &policy) {
+    bool ready = spin_then_yield(policy, [&] {
+        return done(value.load(std::memory_order_acquire));
+    });
+    while (!ready) {
+        T current = value.load(std::memory_order_acquire);
+        if (done(current)) {
+            return;
+        }
+        value.wait(current, std::memory_order_acquire);
+    }
+}
+
+// Wait until value no longer holds old. The writer must still notify, parked waiters rely on it.
+template<class T>
+void wait_while_equal(const std::atomic<T> &value, T old, const WaitPolicy &policy) {
+    wait_until(value, [old] (T current) {
+        return current != old;
+    }, policy);
+}
+
+#endif
@@ -6,12 +6,18 @@
 #include "delta_stepping_sequential.h"
 #include "correctness_checker.h"
 
-int main() {
+int main(int argc, char* argv[]) {
     // std::ios::sync_with_stdio(false);
     // std::cin.tie(0); std::cout.tie(0);
     std::cout << "Parallel Shortest Paths - Algorithm Testing" << std::endl;
     std::cout << "===========================================" << std::endl;
         
+    // ./main [graph_files...]: check the solvers on the given graphs instead of the generated battery
+    if (argc > 1) {
+        run_file_correctness_tests(std::vector<std::string>(argv + 1, argv + argc));
+        return 0;
+    }
+
     run_all_correctness_tests();
     
     return 0;
@@ -0,0 +1,86 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <functional>
+#include "barriers/std_barrier_adapter.h"
+#include "barriers/sense_reversing_barrier.h"
+#include "barriers/dissemination_barrier.h"
+
+// Microbenchmark of the barriers in src/ds/barriers: num_threads threads cross the barrier
+// `episodes` times back to back, reported as the average time per episode.
+// Usage: ./barrier_benchmark [max_threads (64)] [episodes (20000)]
+
+template<class Barrier>
+double time_per_episode_ns(size_t num_threads, size_t episodes, std::unique_ptr<Barrier> barrier) {
+    std::vector<std::thread> threads;
+    auto run = [&] (size_t tid) {
+        for (size_t e = 0; e < episodes; ++e) {
+            barrier->arrive_and_wait(tid);
+        }
+    };
+    // one warm-up episode so thread start-up is not timed
+    for (size_t tid = 1; tid < num_threads; ++tid) {
+        threads.emplace_back([&, tid] {
+            barrier->arrive_and_wait(tid);
+            run(tid);
+        });
+    }
+    barrier->arrive_and_wait(0);
+    auto start = std::chrono::high_resolution_clock::now();
+    run(0);
+    auto end = std::chrono::high_resolution_clock::now();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    return std::chrono::duration<double, std::nano>(end - start).count() / episodes;
+}
+
+int main(int argc, char *argv[]) {
+    size_t max_threads = argc > 1 ? std::stoul(argv[1]) : 64;
+    size_t episodes = argc > 2 ? std::stoul(argv[2]) : 20000;
+
+    struct Variant {
+        std::string name;
+        std::function<double(size_t)> run;
+    };
+    std::vector<Variant> variants = {
+        {"std::barrier", [&] (size_t n) {
+            return time_per_episode_ns(n, episodes, std::make_unique<StdBarrier>(n));
+        }},
+        {"central/park", [&] (size_t n) {
+            return time_per_episode_ns(n, episodes, std::make_unique<SenseReversingBarrier>(n, WaitPolicy::park_only()));
+        }},
+        {"central/hybrid", [&] (size_t n) {
+            return time_per_episode_ns(n, episodes, std::make_unique<SenseReversingBarrier>(n, WaitPolicy{}));
+        }},
+        {"dissem/park", [&] (size_t n) {
+            return time_per_episode_ns(n, episodes, std::make_unique<DisseminationBarrier>(n, WaitPolicy::park_only()));
+        }},
+        {"dissem/hybrid", [&] (size_t n) {
+            return time_per_episode_ns(n, episodes, std::make_unique<DisseminationBarrier>(n, WaitPolicy{}));
+        }},
+    };
+
+    std::cout << "=== Barrier microbenchmark ===" << std::endl;
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << ", episodes: " << episodes << std::endl;
+    std::cout << "Average ns per episode (hybrid = spin, yield, then park; counts above the hardware threads oversubscribe)" << std::endl << std::endl;
+
+    std::cout << std::left << std::setw(10) << "threads";
+    for (const auto &variant : variants) {
+        std::cout << std::right << std::setw(16) << variant.name;
+    }
+    std::cout << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    for (size_t n = 2; n <= max_threads; n *= 2) {
+        std::cout << std::left << std::setw(10) << n;
+        for (const auto &variant : variants) {
+            std::cout << std::right << std::setw(16) << variant.run(n) << std::flush;
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
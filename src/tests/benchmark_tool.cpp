@@ -14,6 +14,7 @@
 #include "algos.h"
 #include "queues/queues.h"
 #include "graph_utils.h"
+#include "pools/thread_placement.h"
 
 // Check if two distance vectors are approximately equal
 bool are_distances_equal(const std::vector<double>& dist1, const std::vector<double>& dist2, double epsilon = 1e-6) {
@@ -71,6 +72,36 @@ SolverConfig make_solver_config(const std::string& config_name, double delta, in
 }
 
 // Create all solver configurations to benchmark - adapted from correctness_checker.h pattern
+// Vertex-state layouts of the optimized parallel solver to benchmark (--layout)
+enum class LayoutMode { SPLIT, PACKED, BOTH };
+LayoutMode layout_mode = LayoutMode::SPLIT;
+// Bucket fusion limit of extra optimized parallel configurations, 0 for none (--fusion)
+size_t fusion_limit = 0;
+// Modes of the optimized parallel solver benchmarked next to its default configuration (--modes)
+struct SolverModes {
+    bool defer_heavy = false, dynamic_split = false, pipelined_heavy = false, two_level = false;
+
+    // Parse a comma separated list of defer, dynamic, pipelined, two-level or all
+    bool parse(const std::string &list) {
+        size_t begin = 0;
+        while (begin <= list.size()) {
+            size_t end = std::min(list.find(',', begin), list.size());
+            std::string mode = list.substr(begin, end - begin);
+            bool all = mode == "all";
+            if (!all && mode != "defer" && mode != "dynamic" && mode != "pipelined" && mode != "two-level") {
+                return false;
+            }
+            defer_heavy |= all || mode == "defer";
+            dynamic_split |= all || mode == "dynamic";
+            pipelined_heavy |= all || mode == "pipelined";
+            two_level |= all || mode == "two-level";
+            begin = end + 1;
+        }
+        return true;
+    }
+};
+SolverModes solver_modes;
+
 std::vector<SolverConfig> create_solver_configurations() {
     std::vector<SolverConfig> configs;
     
@@ -92,10 +123,45 @@ std::vector<SolverConfig> create_solver_configurations() {
     for (double delta : parallel_deltas) {
         for (int threads : thread_counts) {
             // // Delta Stepping Parallel
-            configs.emplace_back(make_solver_config<DeltaSteppingParallel>(
-                "δ=" + std::to_string(delta) + "_t=" + std::to_string(threads),
-                delta, threads, delta, threads));
+            if (layout_mode != LayoutMode::PACKED) {
+                configs.emplace_back(make_solver_config<DeltaSteppingParallel>(
+                    "δ=" + std::to_string(delta) + "_t=" + std::to_string(threads),
+                    delta, threads, delta, threads));
+            }
+            if (layout_mode != LayoutMode::SPLIT) {
+                configs.emplace_back(make_solver_config<DeltaSteppingParallelPacked>(
+                    "δ=" + std::to_string(delta) + "_t=" + std::to_string(threads) + "_packed",
+                    delta, threads, delta, threads));
+            }
+            if (fusion_limit > 0) {
+                configs.emplace_back(make_solver_config<DeltaSteppingParallel>(
+                    "δ=" + std::to_string(delta) + "_t=" + std::to_string(threads) + "_fused",
+                    delta, threads, delta, threads, DeltaSteppingOptions{.fusion_limit = fusion_limit}));
+            }
+            if (solver_modes.defer_heavy) {
+                configs.emplace_back(make_solver_config<DeltaSteppingParallel>(
+                    "δ=" + std::to_string(delta) + "_t=" + std::to_string(threads) + "_defer",
+                    delta, threads, delta, threads, DeltaSteppingOptions{.defer_heavy = true}));
+            }
+            if (solver_modes.dynamic_split) {
+                configs.emplace_back(make_solver_config<DeltaSteppingParallel>(
+                    "δ=" + std::to_string(delta) + "_t=" + std::to_string(threads) + "_dynamic",
+                    delta, threads, delta, threads, DeltaSteppingOptions{.dynamic_split = true}));
+            }
+            if (solver_modes.pipelined_heavy) {
+                configs.emplace_back(make_solver_config<DeltaSteppingParallel>(
+                    "δ=" + std::to_string(delta) + "_t=" + std::to_string(threads) + "_pipelined",
+                    delta, threads, delta, threads, DeltaSteppingOptions{.pipelined_heavy = true}));
+            }
+            if (solver_modes.two_level) {
+                configs.emplace_back(make_solver_config<DeltaSteppingParallelTwoLevel>(
+                    "δ=" + std::to_string(delta) + "_t=" + std::to_string(threads) + "_two_level",
+                    delta, threads, delta, threads));
+            }
 
+            configs.emplace_back(make_solver_config<DeltaSteppingSpmd>(
+                "δ=" + std::to_string(delta) + "_t=" + std::to_string(threads) + "_spmd",
+                delta, threads, delta, threads));
             configs.emplace_back(make_solver_config<DSPRecycleBucket>(
                 "δ=" + std::to_string(delta) + "_t=" + std::to_string(threads),
                 delta, threads, delta, threads));
@@ -118,11 +184,9 @@ std::vector<BenchmarkResult> benchmark_graph(const Graph& graph, const std::stri
     
     std::cout << "\n=== Benchmarking: " << graph_name << " ===" << std::endl;
     std::cout << "Vertices: " << graph.size() << ", Edges: ";
-    int edge_count = 0;
-    for (int u = 0; u < graph.size(); u++) {
-        edge_count += graph[u].size();
-    }
-    std::cout << edge_count << ", Source: " << source << std::endl;
+    int edge_count = graph.num_edges();
+    std::cout << edge_count << ", Max degree: " << graph.max_degree() << ", Source: " << source << std::endl;
+    std::cout << "Edge arrays: " << page_backing_name(graph.page_backing()) << std::endl;
     std::cout << "Runs per configuration: " << num_runs << std::endl;
     
     // Ensure source is valid
@@ -160,6 +224,17 @@ std::vector<BenchmarkResult> benchmark_graph(const Graph& graph, const std::stri
             if ((run + 1) % 10 == 0) std::cout << "\n         ";
         }
         std::cout << std::endl;
+        auto counters = config.solver->last_query_counters();
+        if (!counters.empty()) {
+            std::cout << "  Counters (last run):";
+            for (const auto &[counter, value] : counters) {
+                std::cout << " " << counter << "=" << value;
+            }
+            std::cout << std::endl;
+        }
+        std::cout << "  Large arrays: " << page_backing_summary() << std::endl;
+        // workspaces (buffers + worker threads) are reused across the runs above, free them before the next configuration
+        config.solver->release_workspace();
         
         // Calculate statistics
         long long min_time = *std::min_element(run_times.begin(), run_times.end());
@@ -355,29 +430,77 @@ void save_results_to_csv(const std::vector<BenchmarkResult>& results, const std:
 int main(int argc, char* argv[]) {
     std::cout << "=== SHORTEST PATH ALGORITHMS BENCHMARK TOOL ===" << std::endl;
     std::cout << "Polymorphic benchmark supporting multiple algorithm implementations" << std::endl;
-    std::cout << "Usage: " << argv[0] << " [--runs <number>] [graph_files...]" << std::endl;
-    std::cout << "  --runs <number>: Number of iterations per benchmark (default: 5)" << std::endl;
-    std::cout << "  graph_files:     Specific graph files to benchmark (default: scan assets/test_cases/)" << std::endl;
+    std::cout << "Usage: " << argv[0] << " [--runs <number>] [--affinity <placement>] [--huge-pages <mode>] [--layout <layout>] [--fusion <limit>] [--modes <list>] [graph_files...]" << std::endl;
+    std::cout << "  --runs <number>:        Number of iterations per benchmark (default: 5)" << std::endl;
+    std::cout << "  --affinity <placement>: Pin solver threads: none, compact, scatter, cores or a CPU list like 0,2,4-7 (default: none)" << std::endl;
+    std::cout << "  --huge-pages <mode>:    Backing of large arrays: off, thp (madvise, default) or hugetlb (falls back to thp)" << std::endl;
+    std::cout << "  --layout <layout>:      Vertex state of the optimized parallel solver: split (default), packed or both" << std::endl;
+    std::cout << "  --fusion <limit>:       Also run the optimized parallel solver with bucket fusion of up to limit vertices per task and phase" << std::endl;
+    std::cout << "  --modes <list>:         Also run the optimized parallel solver in these modes, comma separated: defer, dynamic, pipelined, two-level or all" << std::endl;
+    std::cout << "  graph_files:            Specific graph files to benchmark, text edge lists or binary CSR (default: scan assets/test_cases/)" << std::endl;
     
     std::vector<std::string> graph_files;
     int num_runs = 3; // Default number of runs per benchmark
     
     // Parse command line arguments
     int file_arg_start = 1;
-    if (argc > 1 && std::string(argv[1]) == "--runs") {
-        if (argc > 2) {
-            num_runs = std::atoi(argv[2]);
+    for (; file_arg_start < argc && std::string(argv[file_arg_start]).rfind("--", 0) == 0; file_arg_start += 2) {
+        std::string option = argv[file_arg_start];
+        if (file_arg_start + 1 >= argc) {
+            std::cout << "Error: " << option << " option requires a value" << std::endl;
+            return 1;
+        }
+        std::string value = argv[file_arg_start + 1];
+        if (option == "--runs") {
+            num_runs = std::atoi(value.c_str());
             if (num_runs <= 0) {
                 std::cout << "Error: Number of runs must be positive" << std::endl;
                 return 1;
             }
-            file_arg_start = 3;
             std::cout << "Configured to run " << num_runs << " iterations per benchmark" << std::endl;
-        } else {
-            std::cout << "Error: --runs option requires a number" << std::endl;
+        }
+        else if (option == "--affinity") {
+            if (!ThreadPlacement::parse(value, default_thread_placement())) {
+                return 1;
+            }
+        }
+        else if (option == "--layout") {
+            if (value == "split" || value == "packed" || value == "both") {
+                layout_mode = value == "split" ? LayoutMode::SPLIT : value == "packed" ? LayoutMode::PACKED : LayoutMode::BOTH;
+            }
+            else {
+                std::cout << "Error: --layout must be split, packed or both" << std::endl;
+                return 1;
+            }
+        }
+        else if (option == "--fusion") {
+            long limit = std::atol(value.c_str());
+            if (limit <= 0) {
+                std::cout << "Error: --fusion limit must be positive" << std::endl;
+                return 1;
+            }
+            fusion_limit = limit;
+        }
+        else if (option == "--modes") {
+            if (!solver_modes.parse(value)) {
+                std::cout << "Error: --modes must list defer, dynamic, pipelined, two-level or all" << std::endl;
+                return 1;
+            }
+        }
+        else if (option == "--huge-pages") {
+            if (!parse_huge_page_mode(value, default_huge_page_mode())) {
+                std::cout << "Error: --huge-pages must be off, thp or hugetlb" << std::endl;
+                return 1;
+            }
+        }
+        else {
+            std::cout << "Error: unknown option " << option << std::endl;
             return 1;
         }
     }
+    // the benchmarking thread submits the work, it takes slot 0 of the placement
+    default_thread_placement().pin_current_thread(0);
+    std::cout << "Thread placement: " << default_thread_placement().describe() << std::endl;
     
     // If specific files are provided as arguments, use them
     if (argc > file_arg_start) {
@@ -385,18 +508,18 @@ int main(int argc, char* argv[]) {
             graph_files.push_back(argv[i]);
         }
     } else {
-        // Default: scan the assets/test_cases directory for all .txt files
+        // Default: scan the assets/test_cases directory for all .txt / .bin files
         std::string test_cases_dir = "assets/test_cases";
         
-        // Check if directory exists and scan for .txt files
+        // Check if directory exists and scan for graph files
         DIR* dir = opendir(test_cases_dir.c_str());
         if (dir != nullptr) {
             struct dirent* entry;
             while ((entry = readdir(dir)) != nullptr) {
                 std::string filename = entry->d_name;
-                // Check if file ends with .txt
+                // Check if file ends with .txt (text edge list) or .bin (binary CSR)
                 if (filename.length() > 4 && 
-                    filename.substr(filename.length() - 4) == ".txt") {
+                    (filename.substr(filename.length() - 4) == ".txt" || filename.substr(filename.length() - 4) == ".bin")) {
                     std::string full_path = test_cases_dir + "/" + filename;
                     graph_files.push_back(full_path);
                 }
@@ -459,11 +582,15 @@ int main(int argc, char* argv[]) {
     // Benchmark each graph
     for (const auto& file : graph_files) {
         try {
-            Graph graph = parse_graph_from_file(file, false); // Enable weight normalization to [0, 1]
+            Graph graph = load_graph(file, false); // Enable weight normalization to [0, 1]
             if (graph.size() == 0) {
                 std::cout << "Skipping empty graph: " << file << std::endl;
                 continue;
             }
+            // sorted once here, every delta then splits the rows in place instead of copying them
+            if (graph.neighbor_order() != NeighborOrder::BY_WEIGHT) {
+                graph = graph.with_neighbor_order(NeighborOrder::BY_WEIGHT);
+            }
             
             // Extract graph name from filename
             std::string graph_name = file;
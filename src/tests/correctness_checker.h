@@ -178,6 +178,13 @@ bool test_graph_parallel(const Graph& graph, int source, double delta, int num_t
     solvers.push_back(std::make_unique<DeltaSteppingSequential>(delta));
     
     solvers.push_back(std::make_unique<DeltaSteppingParallel>(delta, num_threads));
+    solvers.push_back(std::make_unique<DeltaSteppingParallelPacked>(delta, num_threads));
+    solvers.push_back(std::make_unique<DeltaSteppingParallelTwoLevel>(delta, num_threads));
+    solvers.push_back(std::make_unique<DeltaSteppingParallel>(delta, num_threads, DeltaSteppingOptions{.fusion_limit = 64}));
+    solvers.push_back(std::make_unique<DeltaSteppingParallel>(delta, num_threads, DeltaSteppingOptions{.defer_heavy = true}));
+    solvers.push_back(std::make_unique<DeltaSteppingParallel>(delta, num_threads, DeltaSteppingOptions{.dynamic_split = true}));
+    solvers.push_back(std::make_unique<DeltaSteppingParallel>(delta, num_threads, DeltaSteppingOptions{.pipelined_heavy = true}));
+    solvers.push_back(std::make_unique<DeltaSteppingSpmd>(delta, num_threads));
     solvers.push_back(std::make_unique<DSPRecycleBucket>(delta, num_threads));
     // solvers.push_back(std::make_unique<DeltaSteppingOpenMP>(delta, num_threads));
     // solvers.push_back(std::make_unique<DeltaSteppingDynamic>(delta, num_threads));
@@ -254,6 +261,10 @@ void run_parallel_correctness_tests() {
         int m = 6000; // n to 3n edges
         int random_seed = seed_dist(gen);
         Graph graph = generate_random_graph(n, m, 0.0, 1.0, true, WeightDistribution::UNIFORM, random_seed);
+        // every other graph is sorted by weight to cover the in-place light/heavy split
+        if (test % 2 == 1) {
+            graph = graph.with_neighbor_order(NeighborOrder::BY_WEIGHT);
+        }
         std::cout << "  Sparse graph " << (test+1) << "/10 (n=" << graph.size() << ", m=" << m << ") using seed: " << random_seed << std::endl;
         
         std::vector<double> deltas = {0.01, 0.1, 0.2, 0.3, 0.4, 0.5, 0.6, 0.7, 0.8, 0.9, 1.0};
@@ -373,6 +384,39 @@ void run_parallel_correctness_tests() {
     }
 }
 
+// Check every solver against Dijkstra on graphs loaded from files (text edge lists or binary CSR)
+void run_file_correctness_tests(const std::vector<std::string>& graph_files) {
+    std::cout << "=== Delta Stepping Correctness Tests on Graph Files ===" << std::endl << std::endl;
+
+    int total_tests = 0;
+    int passed_tests = 0;
+    std::vector<double> deltas = {0.01, 0.1, 0.5};
+    std::vector<int> thread_counts = {1, 4, 8};
+
+    for (const auto& file : graph_files) {
+        Graph graph = load_graph(file);
+        if (graph.size() == 0) {
+            std::cout << "Skipping empty graph: " << file << std::endl;
+            continue;
+        }
+        for (double delta : deltas) {
+            for (int threads : thread_counts) {
+                total_tests++;
+                std::cout << "  Running test " << total_tests << " (" << file << ", delta=" << delta << ", threads=" << threads << ")";
+                if (test_graph_parallel(graph, 0, delta, threads)) {
+                    passed_tests++;
+                    std::cout << " - PASS" << std::endl;
+                } else {
+                    std::cout << " - FAIL" << std::endl;
+                }
+            }
+        }
+    }
+
+    std::cout << std::endl << "=== File Test Summary ===" << std::endl;
+    std::cout << "Passed: " << passed_tests << "/" << total_tests << std::endl;
+}
+
 // Combined test runner that runs both sequential and parallel tests
 void run_all_correctness_tests() {
     run_parallel_correctness_tests();
@@ -0,0 +1,54 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include "graph.h"
+#include "graph_binary.h"
+#include "graph_utils.h"
+
+// Convert text edge lists into the binary CSR format that benchmark and main can map directly
+// --dense-ids keeps the vertex ids of the input (they must already be 0..n-1) instead of relabeling them
+// --sort-by-weight stores every adjacency sorted by weight, so solvers can split it in place for any delta
+int main(int argc, char* argv[]) {
+    int first = 1;
+    VertexLabeling labeling = VertexLabeling::FIRST_SEEN;
+    bool sort_by_weight = false;
+    for (; first < argc && std::string(argv[first]).rfind("--", 0) == 0; ++first) {
+        std::string option = argv[first];
+        if (option == "--dense-ids") {
+            labeling = VertexLabeling::KEEP_IDS;
+        }
+        else if (option == "--sort-by-weight") {
+            sort_by_weight = true;
+        }
+        else {
+            std::cout << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+    if (argc - first < 2 || (argc - first) % 2 != 0) {
+        std::cout << "Usage: " << argv[0] << " [--dense-ids] [--sort-by-weight] <input.txt> <output.bin> [<input.txt> <output.bin> ...]" << std::endl;
+        return 1;
+    }
+
+    for (int i = first; i + 1 < argc; i += 2) {
+        std::string input = argv[i];
+        std::string output = argv[i + 1];
+
+        auto start = std::chrono::high_resolution_clock::now();
+        Graph graph = parse_graph_from_file(input, false, default_thread_count(), labeling);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::cout << "  Parse time: " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms" << std::endl;
+
+        if (graph.size() == 0) {
+            std::cout << "Skipping empty graph: " << input << std::endl;
+            continue;
+        }
+        if (sort_by_weight) {
+            graph = graph.with_neighbor_order(NeighborOrder::BY_WEIGHT);
+        }
+        if (!save_graph_to_binary_file(graph, output)) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -11,7 +11,20 @@
 #include <iostream>
 #include <sstream>
 #include <cmath>
+#include <charconv>
+#include <cstring>
+#include <cctype>
+#include <bit>
+#include <limits>
+#include <numeric>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "graph.h"
+#include "parallel_utils.h"
+#include "graph_binary.h"
+#include "atomics/concurrent_bitmap.h"
 
 // Enum for weight distribution types
 enum class WeightDistribution {
@@ -53,70 +66,314 @@ public:
     }
 };
 
+// Field parsers for the text edge list. They accept what std::stoi / std::stod accepted in the old
+// getline-based loader: leading whitespace, an optional sign and trailing garbage after the number.
+inline bool parse_int_field(const char *first, const char *last, int &value) {
+    while (first < last && std::isspace((unsigned char)*first)) ++first;
+    if (first < last && *first == '+' && last - first > 1 && *(first + 1) != '-') ++first;
+    auto [ptr, ec] = std::from_chars(first, last, value);
+    return ec == std::errc();
+}
+
+inline bool parse_double_field(const char *first, const char *last, double &value) {
+    while (first < last && std::isspace((unsigned char)*first)) ++first;
+    if (first < last && *first == '+' && last - first > 1 && *(first + 1) != '-') ++first;
+    auto [ptr, ec] = std::from_chars(first, last, value);
+    return ec == std::errc();
+}
+
+// Parse the "u v w" lines in [first, last) (a run of whole lines) into edges with the raw vertex ids.
+// Lines with missing fields or unparsable numbers are skipped, like the old loader did.
+inline void parse_edge_lines(const char *first, const char *last, std::vector<Edge> &edges, double &max_w) {
+    while (first < last) {
+        const char *line_end = static_cast<const char*>(std::memchr(first, '\n', last - first));
+        if (line_end == nullptr) {
+            line_end = last;
+        }
+        const char *pos1 = static_cast<const char*>(std::memchr(first, ' ', line_end - first));
+        const char *pos2 = pos1 == nullptr ? nullptr : static_cast<const char*>(std::memchr(pos1 + 1, ' ', line_end - pos1 - 1));
+        int u, v;
+        double w;
+        if (pos2 != nullptr &&
+            parse_int_field(first, pos1, u) &&
+            parse_int_field(pos1 + 1, pos2, v) &&
+            parse_double_field(pos2 + 1, line_end, w)) {
+            max_w = std::max(max_w, w);
+            edges.push_back({u, v, w});
+        }
+        first = line_end + 1;
+    }
+}
+
+// How parse_graph_from_file numbers the vertices
+enum class VertexLabeling {
+    FIRST_SEEN,  // relabel to 0..n-1 in order of first appearance in the file
+    KEEP_IDS     // ids are already dense 0..n-1, use them as they are (n = max id + 1)
+};
+
+// Start of every chunk within the flattened edge list, plus the total at the end
+inline std::vector<size_t> chunk_offsets(const std::vector<std::vector<Edge>> &chunks) {
+    std::vector<size_t> offsets(chunks.size() + 1, 0);
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        offsets[c + 1] = offsets[c] + chunks[c].size();
+    }
+    return offsets;
+}
+
+// Relabel the raw ids of the parsed chunks to 0..n-1 in order of first appearance (u before v on a line)
+// and flatten the chunks into edges. Returns n, or -1 if the input is too large.
+// Sort-based, no hash map: every endpoint becomes a key (id << 32 | position), position being
+// 2 * edge index + (0 for u, 1 for v). Each chunk radix-sorts and deduplicates its keys batch by batch,
+// the per-chunk survivors are merged with one more parallel sort, and the first key of every id
+// carries its first position. Sorting those by position gives the labels.
+inline int relabel_first_seen(std::vector<std::vector<Edge>> &chunks, std::vector<Edge> &edges, size_t num_threads) {
+    size_t num_chunks = chunks.size();
+    std::vector<size_t> offsets = chunk_offsets(chunks);
+    size_t total_edges = offsets[num_chunks];
+    if (2 * total_edges > std::numeric_limits<uint32_t>::max()) {
+        std::cerr << "Error: too many edges to relabel (" << total_edges << ")" << std::endl;
+        return -1;
+    }
+
+    // flipping the sign bit keeps the order of ints among unsigned keys
+    auto id_key = [] (int id) {
+        return uint64_t(uint32_t(id) ^ 0x80000000u) << 32;
+    };
+    auto key_id = [] (uint64_t key) {
+        return int(uint32_t(key >> 32) ^ 0x80000000u);
+    };
+    // keys are sorted stably by id only, so positions stay ascending within an id
+    auto dedup_sorted = [] (std::vector<uint64_t> &keys) {
+        auto last = std::unique(keys.begin(), keys.end(), [] (uint64_t a, uint64_t b) {
+            return (a >> 32) == (b >> 32);
+        });
+        keys.erase(last, keys.end());
+    };
+
+    // 1. first position of every id within each chunk, in batches to bound the scratch memory
+    const size_t batch_edges = 1 << 20;
+    std::vector<std::vector<uint64_t>> chunk_keys(num_chunks);
+    run_on_threads(num_chunks, [&] (size_t c) {
+        std::vector<uint64_t> &unique_keys = chunk_keys[c];
+        std::vector<uint64_t> batch, buffer;
+        const std::vector<Edge> &chunk = chunks[c];
+        for (size_t begin = 0; begin < chunk.size(); begin += batch_edges) {
+            size_t end = std::min(chunk.size(), begin + batch_edges);
+            batch.clear();
+            uint64_t pos = 2 * (offsets[c] + begin);
+            for (size_t i = begin; i < end; ++i, pos += 2) {
+                batch.push_back(id_key(chunk[i].u) | pos);
+                batch.push_back(id_key(chunk[i].v) | (pos + 1));
+            }
+            radix_sort(batch, buffer, 32, 64);
+            dedup_sorted(batch);
+            unique_keys.insert(unique_keys.end(), batch.begin(), batch.end());
+        }
+        radix_sort(unique_keys, buffer, 32, 64);
+        dedup_sorted(unique_keys);
+    });
+
+    // 2. merge the chunks (concatenated in file order, so the sort keeps positions ascending within an id)
+    std::vector<size_t> key_offsets(num_chunks + 1, 0);
+    for (size_t c = 0; c < num_chunks; ++c) {
+        key_offsets[c + 1] = key_offsets[c] + chunk_keys[c].size();
+    }
+    std::vector<uint64_t> keys(key_offsets[num_chunks]), buffer;
+    run_on_threads(num_chunks, [&] (size_t c) {
+        std::copy(chunk_keys[c].begin(), chunk_keys[c].end(), keys.begin() + key_offsets[c]);
+        std::vector<uint64_t>().swap(chunk_keys[c]);
+    });
+    radix_sort(keys, buffer, 32, 64, num_threads);
+
+    // 3. keep the first key of every id: unique_ids is sorted, order holds (first position << 32 | rank in unique_ids)
+    size_t num_keys = keys.size();
+    std::vector<size_t> block_unique(num_threads + 1, 0);
+    auto is_first = [&] (size_t i) {
+        return i == 0 || (keys[i] >> 32) != (keys[i - 1] >> 32);
+    };
+    run_on_threads(num_threads, [&] (size_t tid) {
+        auto [begin, end] = block_range(num_keys, num_threads, tid);
+        for (size_t i = begin; i < end; ++i) {
+            block_unique[tid + 1] += is_first(i);
+        }
+    });
+    for (size_t tid = 0; tid < num_threads; ++tid) {
+        block_unique[tid + 1] += block_unique[tid];
+    }
+    size_t num_vertices = block_unique[num_threads];
+    if (num_vertices > (size_t)std::numeric_limits<int>::max()) {
+        std::cerr << "Error: too many vertices (" << num_vertices << ")" << std::endl;
+        return -1;
+    }
+    std::vector<int> unique_ids(num_vertices);
+    std::vector<uint64_t> order(num_vertices);
+    run_on_threads(num_threads, [&] (size_t tid) {
+        auto [begin, end] = block_range(num_keys, num_threads, tid);
+        size_t rank = block_unique[tid];
+        for (size_t i = begin; i < end; ++i) {
+            if (is_first(i)) {
+                unique_ids[rank] = key_id(keys[i]);
+                order[rank] = (keys[i] << 32) | rank;
+                ++rank;
+            }
+        }
+    });
+    std::vector<uint64_t>().swap(keys);
+
+    // 4. the label of an id is the rank of its first position
+    int position_bits = std::bit_width(2 * total_edges);
+    radix_sort(order, buffer, 32, 32 + position_bits, num_threads);
+    std::vector<uint64_t>().swap(buffer);
+    std::vector<int> label(num_vertices);
+    run_on_threads(num_threads, [&] (size_t tid) {
+        auto [begin, end] = block_range(num_vertices, num_threads, tid);
+        for (size_t i = begin; i < end; ++i) {
+            label[order[i] & 0xffffffffu] = (int)i;
+        }
+    });
+    std::vector<uint64_t>().swap(order);
+
+    // 5. rewrite the endpoints: direct table when the raw ids are compact enough, binary search otherwise
+    int64_t min_id = num_vertices == 0 ? 0 : unique_ids.front();
+    int64_t id_range = num_vertices == 0 ? 0 : (int64_t)unique_ids.back() - min_id + 1;
+    std::vector<int> table;
+    if (id_range <= 4 * (int64_t)num_vertices) {
+        table.resize(id_range);
+        run_on_threads(num_threads, [&] (size_t tid) {
+            auto [begin, end] = block_range(num_vertices, num_threads, tid);
+            for (size_t i = begin; i < end; ++i) {
+                table[unique_ids[i] - min_id] = label[i];
+            }
+        });
+    }
+    auto lookup = [&] (int id) {
+        if (!table.empty()) {
+            return table[id - min_id];
+        }
+        return label[std::lower_bound(unique_ids.begin(), unique_ids.end(), id) - unique_ids.begin()];
+    };
+
+    edges.resize(total_edges);
+    run_on_threads(num_chunks, [&] (size_t c) {
+        Edge *out = edges.data() + offsets[c];
+        for (const auto &[u, v, w] : chunks[c]) {
+            *out++ = {lookup(u), lookup(v), w};
+        }
+        std::vector<Edge>().swap(chunks[c]);
+    });
+    return (int)num_vertices;
+}
+
+// Flatten the chunks keeping the raw ids, which must already be dense. Returns n (max id + 1),
+// or -1 on a negative id or ids too sparse to keep.
+inline int keep_vertex_ids(std::vector<std::vector<Edge>> &chunks, std::vector<Edge> &edges, size_t num_threads) {
+    size_t num_chunks = chunks.size();
+    std::vector<size_t> offsets = chunk_offsets(chunks);
+    std::vector<int> chunk_min(num_chunks, 0), chunk_max(num_chunks, -1);
+    edges.resize(offsets[num_chunks]);
+    run_on_threads(num_chunks, [&] (size_t c) {
+        Edge *out = edges.data() + offsets[c];
+        for (const Edge &edge : chunks[c]) {
+            chunk_min[c] = std::min({chunk_min[c], edge.u, edge.v});
+            chunk_max[c] = std::max({chunk_max[c], edge.u, edge.v});
+            *out++ = edge;
+        }
+        std::vector<Edge>().swap(chunks[c]);
+    });
+    if (*std::min_element(chunk_min.begin(), chunk_min.end()) < 0) {
+        std::cerr << "Error: negative vertex id, the ids are not dense" << std::endl;
+        return -1;
+    }
+    int max_id = *std::max_element(chunk_max.begin(), chunk_max.end());
+    if (max_id == std::numeric_limits<int>::max()) {
+        std::cerr << "Error: vertex id too large" << std::endl;
+        return -1;
+    }
+    // the graph and every workspace are sized by max id + 1, so a stray large id must not blow them up:
+    // accept at most 4 slots per distinct id, as the direct table of relabel_first_seen() does
+    size_t total_edges = edges.size(), id_range = (size_t)max_id + 1;
+    size_t num_ids = 0;
+    if (id_range <= 8 * total_edges) {
+        ConcurrentBitmap seen(id_range);
+        std::vector<size_t> block_ids(num_threads, 0);
+        run_on_threads(num_threads, [&] (size_t tid) {
+            auto [begin, end] = block_range(total_edges, num_threads, tid);
+            for (size_t i = begin; i < end; ++i) {
+                block_ids[tid] += !seen.test_and_set(edges[i].u);
+                block_ids[tid] += !seen.test_and_set(edges[i].v);
+            }
+        });
+        num_ids = std::accumulate(block_ids.begin(), block_ids.end(), size_t(0));
+    }
+    if (id_range > 4 * std::max<size_t>(num_ids, 1)) {
+        std::cerr << "Error: vertex ids are too sparse to keep (max id " << max_id << ", "
+                  << (num_ids > 0 ? std::to_string(num_ids) : "far fewer") << " distinct ids), relabel them instead" << std::endl;
+        return -1;
+    }
+    return max_id + 1;
+}
+
 // Function to parse graph from file (u v w format) - optimized for large files
-Graph parse_graph_from_file(const std::string& filename, bool normalize_weights = false) {
-    std::ifstream in(filename);
-    if (!in.is_open()) {
+// The file is mapped and cut into newline-aligned chunks parsed concurrently, one per thread.
+// Vertices are relabeled 0..n-1 in order of first appearance in the file, unless labeling is KEEP_IDS.
+Graph parse_graph_from_file(const std::string& filename, bool normalize_weights = false, size_t num_threads = default_thread_count(),
+                            VertexLabeling labeling = VertexLabeling::FIRST_SEEN) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
         std::cerr << "Error: Could not open file " << filename << std::endl;
         return Graph(0, {});
     }
-    
-    // Get file size to estimate number of edges for better memory allocation
-    in.seekg(0, std::ios::end);
-    std::streamsize file_size = in.tellg();
-    in.seekg(0, std::ios::beg);
-    
-    // Estimate number of lines (rough estimate: assume 20 chars per line on average)
-    size_t estimated_edges = file_size / 20;
-    
-    std::vector<Edge> edges;
-    edges.reserve(estimated_edges);  // Pre-allocate to avoid reallocations
-    
-    std::unordered_map<int, int> index_map;
-    index_map.reserve(estimated_edges / 2);  // Rough estimate of unique vertices
-    
-    int cnt = 0;
-    double max_w = 0.0;
-    
-    // Use larger buffer for faster I/O
-    std::string line;
-    line.reserve(64);  // Reserve space for typical line length
-    
-    while (std::getline(in, line)) {
-        // Skip empty lines
-        if (line.empty()) continue;
-        
-        // Fast parsing using find and substr (faster than stringstream)
-        size_t pos1 = line.find(' ');
-        if (pos1 == std::string::npos) continue;
-        
-        size_t pos2 = line.find(' ', pos1 + 1);
-        if (pos2 == std::string::npos) continue;
-        
-        try {
-            int u = std::stoi(line.substr(0, pos1));
-            int v = std::stoi(line.substr(pos1 + 1, pos2 - pos1 - 1));
-            double w = std::stod(line.substr(pos2 + 1));
-            
-            // Use emplace for more efficient insertion (single lookup)
-            auto result_u = index_map.emplace(u, cnt);
-            if (result_u.second) cnt++;  // New vertex inserted
-            
-            auto result_v = index_map.emplace(v, cnt);
-            if (result_v.second) cnt++;  // New vertex inserted
-            
-            max_w = std::max(max_w, w);
-            edges.emplace_back(result_u.first->second, result_v.first->second, w);
-            
-        } catch (const std::exception&) {
-            // Skip malformed lines
-            continue;
+    struct stat st;
+    size_t file_size = fstat(fd, &st) == 0 ? st.st_size : 0;
+    const char *data = nullptr;
+    if (file_size > 0) {
+        void *mapped = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            data = static_cast<const char*>(mapped);
+            madvise(mapped, file_size, MADV_SEQUENTIAL);
         }
     }
-    
-    // Shrink to fit to free unused memory
-    edges.shrink_to_fit();
-    
+    close(fd);
+    if (file_size > 0 && data == nullptr) {
+        std::cerr << "Error: Could not map file " << filename << std::endl;
+        return Graph(0, {});
+    }
+
+    // Small files are not worth the threads
+    const size_t min_chunk_bytes = 1 << 20;
+    num_threads = std::max<size_t>(1, std::min(num_threads, file_size / min_chunk_bytes));
+
+    // chunk t covers [chunk_begin[t], chunk_begin[t + 1]), every boundary sits right after a newline
+    std::vector<size_t> chunk_begin(num_threads + 1, file_size);
+    chunk_begin[0] = 0;
+    for (size_t t = 1; t < num_threads; ++t) {
+        size_t pos = std::max(chunk_begin[t - 1], t * (file_size / num_threads));
+        const char *newline = pos < file_size ? static_cast<const char*>(std::memchr(data + pos, '\n', file_size - pos)) : nullptr;
+        chunk_begin[t] = newline == nullptr ? file_size : newline - data + 1;
+    }
+
+    std::vector<std::vector<Edge>> chunk_edges(num_threads);
+    std::vector<double> chunk_max_w(num_threads, 0.0);
+    run_on_threads(num_threads, [&] (size_t tid) {
+        size_t begin = chunk_begin[tid], end = chunk_begin[tid + 1];
+        // Estimate number of lines (rough estimate: assume 20 chars per line on average)
+        chunk_edges[tid].reserve((end - begin) / 20);
+        parse_edge_lines(data + begin, data + end, chunk_edges[tid], chunk_max_w[tid]);
+    });
+    if (data != nullptr) {
+        munmap(const_cast<char*>(data), file_size);
+    }
+
+    double max_w = *std::max_element(chunk_max_w.begin(), chunk_max_w.end());
+
+    std::vector<Edge> edges;
+    int cnt = labeling == VertexLabeling::FIRST_SEEN ? relabel_first_seen(chunk_edges, edges, num_threads)
+                                                     : keep_vertex_ids(chunk_edges, edges, num_threads);
+    if (cnt < 0) {
+        std::cerr << "Error: Could not label the vertices of " << filename << std::endl;
+        return Graph(0, {});
+    }
+
     if (normalize_weights && max_w > 0.0) {
         // Vectorized division for better performance
         const double inv_max_w = 1.0 / max_w;
@@ -124,11 +381,38 @@ Graph parse_graph_from_file(const std::string& filename, bool normalize_weights
             edge.w *= inv_max_w;
         }
     }
-    
+
     std::cout << "Loaded graph from " << filename << ": " << cnt << " vertices, " << edges.size() << " edges" << std::endl;
     return Graph(cnt, edges);
 }
 
+// Load a graph in either supported format: binary CSR files (see graph_binary.h) are mapped without copying,
+// anything else is parsed as a text edge list
+Graph load_graph(const std::string& filename, bool normalize_weights = false, VertexLabeling labeling = VertexLabeling::FIRST_SEEN) {
+    if (!is_binary_graph_file(filename)) {
+        return parse_graph_from_file(filename, normalize_weights, default_thread_count(), labeling);
+    }
+
+    Graph graph = map_graph_from_binary_file(filename);
+    double max_w = graph.get_max_edge_weight();
+    if (!normalize_weights || max_w <= 0.0) {
+        return graph;
+    }
+
+    // the mapping is read-only, normalized weights need an owned copy
+    int n = graph.size();
+    size_t m = graph.num_edges();
+    HugePageVector<size_t> offsets(graph.offset_data(), graph.offset_data() + n + 1);
+    HugePageVector<int> targets(graph.target_data(), graph.target_data() + m);
+    HugePageVector<double> weights(graph.weight_data(), graph.weight_data() + m);
+    const double inv_max_w = 1.0 / max_w;
+    for (double &w : weights) {
+        w *= inv_max_w;
+    }
+    // scaling by a positive factor keeps the rows in order
+    return Graph(n, std::move(offsets), std::move(targets), std::move(weights), graph.neighbor_order());
+}
+
 void save_graph_to_file(const Graph& graph, const std::string& filename) {
     std::ofstream file(filename);
     if (!file.is_open()) {